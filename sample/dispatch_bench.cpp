@@ -0,0 +1,213 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+
+#include "wdk/system.h"
+#include "wdk/window.h"
+#include "wdk/events.h"
+#include "wdk/listener.h"
+#if !defined(_WIN32)
+#  include "wdk/recorder.h"
+#endif
+
+// Compare the cost of dispatching window events through the
+// std::function callbacks (with a WindowListener connected to the window)
+// against the compile time dispatch with Window::ProcessEvent(ev, listener).
+//
+// The input events are either captured live from the window or
+// (on X11) read from a recording made with EventReplaySample.
+//
+// dispatch_bench [--events file] [--iterations N]
+
+struct Totals {
+    unsigned events = 0;
+    long long sum   = 0;
+};
+
+class VirtualListener : public wdk::WindowListener
+{
+public:
+    VirtualListener(Totals& totals) : totals_(totals)
+    {}
+    virtual void OnKeyDown(const wdk::WindowEventKeyDown& key) override
+    { totals_.events++; totals_.sum += (int)key.symbol; }
+    virtual void OnKeyUp(const wdk::WindowEventKeyUp& key) override
+    { totals_.events++; totals_.sum += (int)key.symbol; }
+    virtual void OnChar(const wdk::WindowEventChar& c) override
+    { totals_.events++; totals_.sum += c.ascii; }
+    virtual void OnMouseMove(const wdk::WindowEventMouseMove& mickey) override
+    { totals_.events++; totals_.sum += mickey.window_x + mickey.window_y; }
+    virtual void OnMousePress(const wdk::WindowEventMousePress& mickey) override
+    { totals_.events++; totals_.sum += mickey.window_x + mickey.window_y; }
+    virtual void OnMouseRelease(const wdk::WindowEventMouseRelease& mickey) override
+    { totals_.events++; totals_.sum += mickey.window_x + mickey.window_y; }
+private:
+    Totals& totals_;
+};
+
+class StaticListener final : public wdk::StaticWindowListener
+{
+public:
+    StaticListener(Totals& totals) : totals_(totals)
+    {}
+    void OnKeyDown(const wdk::WindowEventKeyDown& key)
+    { totals_.events++; totals_.sum += (int)key.symbol; }
+    void OnKeyUp(const wdk::WindowEventKeyUp& key)
+    { totals_.events++; totals_.sum += (int)key.symbol; }
+    void OnChar(const wdk::WindowEventChar& c)
+    { totals_.events++; totals_.sum += c.ascii; }
+    void OnMouseMove(const wdk::WindowEventMouseMove& mickey)
+    { totals_.events++; totals_.sum += mickey.window_x + mickey.window_y; }
+    void OnMousePress(const wdk::WindowEventMousePress& mickey)
+    { totals_.events++; totals_.sum += mickey.window_x + mickey.window_y; }
+    void OnMouseRelease(const wdk::WindowEventMouseRelease& mickey)
+    { totals_.events++; totals_.sum += mickey.window_x + mickey.window_y; }
+private:
+    Totals& totals_;
+};
+
+// Only input events are benchmarked since they can be processed
+// any number of times without side effects.
+bool IsInputEvent(const wdk::native_event_t& ev)
+{
+    using type = wdk::native_event_t::type;
+    switch (ev.identity())
+    {
+        case type::window_keydown:
+        case type::window_keyup:
+        case type::window_mouse_move:
+        case type::window_mouse_press:
+        case type::window_mouse_release:
+            return true;
+        default:
+            break;
+    }
+    return false;
+}
+
+template<typename Function>
+double Measure(unsigned iterations, Function func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i=0; i<iterations; ++i)
+        func();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    const char* file = nullptr;
+    unsigned iterations = 1000;
+
+    for (int i=1; i<argc; ++i)
+    {
+        if (!strcmp(argv[i], "--events") && i + 1 < argc)
+            file = argv[++i];
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+            iterations = atoi(argv[++i]);
+        else
+        {
+            std::cerr << "Incorrect command line\n";
+            return 1;
+        }
+    }
+
+    wdk::Window win;
+    win.Create("Move the mouse and type, close the window to start", 640, 480, 0);
+
+    std::vector<wdk::native_event_t> events;
+
+    if (file)
+    {
+#if !defined(_WIN32)
+        wdk::EventPlayer player(file);
+        player.SetWindow(win.GetNativeHandle());
+
+        wdk::native_event_t event;
+        while (player.NextEvent(event))
+        {
+            if (IsInputEvent(event))
+                events.push_back(event);
+        }
+#else
+        std::cerr << "Event recordings are not supported on this platform\n";
+        return 1;
+#endif
+    }
+    else
+    {
+        bool closed = false;
+        win.OnWantClose = [&](const wdk::WindowEventWantClose&) {
+            closed = true;
+        };
+        while (!closed)
+        {
+            wdk::native_event_t event;
+            wdk::WaitEvent(event);
+            if (IsInputEvent(event))
+                events.push_back(event);
+            win.ProcessEvent(event);
+        }
+        win.OnWantClose = nullptr;
+    }
+
+    if (events.empty())
+    {
+        std::cerr << "No input events to dispatch\n";
+        return 1;
+    }
+
+    Totals callback_totals;
+    Totals static_totals;
+
+    VirtualListener virtual_listener(callback_totals);
+    StaticListener static_listener(static_totals);
+
+    wdk::Connect(win, virtual_listener);
+    const double callback_ns = Measure(iterations, [&]() {
+        for (const auto& event : events)
+            win.ProcessEvent(event);
+    });
+    wdk::Disconnect(win);
+
+    const double static_ns = Measure(iterations, [&]() {
+        for (const auto& event : events)
+            win.ProcessEvent(event, static_listener);
+    });
+
+    const double count = double(events.size()) * iterations;
+
+    std::cout << "Dispatched " << events.size() << " events " << iterations << " times\n";
+    std::cout << "std::function callbacks: " << callback_ns / count << " ns/event"
+              << " (checksum " << callback_totals.sum << ")\n";
+    std::cout << "Template dispatch:       " << static_ns / count << " ns/event"
+              << " (checksum " << static_totals.sum << ")\n";
+
+    win.Destroy();
+    return 0;
+}
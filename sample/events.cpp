@@ -28,6 +28,7 @@
 
 #include "wdk/system.h"
 #include "wdk/videomode.h"
+#include "wdk/monitor.h"
 #include "wdk/modechange.h"
 #include "wdk/window.h"
 #include "wdk/events.h"
@@ -74,6 +75,11 @@ void handle_window_create(const wdk::WindowEventCreate& create)
     printf("Window create: @%d,%d, %d x %d\n", create.x, create.y, create.width, create.height);
 }
 
+void handle_window_show(const wdk::WindowEventShow& show)
+{
+    printf("Window show\n");
+}
+
 void handle_window_want_close(const wdk::WindowEventWantClose& want_close)
 {
     printf("Window want close:\n");
@@ -141,6 +147,7 @@ struct cmdline {
     bool   print_help     = false;
     bool   fullscreen     = false;
     bool   listmodes      = false;
+    bool   listmonitors   = false;
     bool   wnd_border     = true;
     bool   wnd_resize     = true;
     bool   show_cursor    = true;
@@ -163,6 +170,8 @@ bool parse_cmdline(int argc, char* argv[], cmdline& cmd)
             cmd.fullscreen = true;
         else if (!strcmp(name, "--list-modes"))
             cmd.listmodes = true;
+        else if (!strcmp(name, "--list-monitors"))
+            cmd.listmonitors = true;
         else if (!strcmp(name, "--wnd-no-border"))
             cmd.wnd_border = false;
         else if (!strcmp(name, "--wnd-no-resize"))
@@ -219,6 +228,7 @@ int main(int argc, char* argv[])
     cmd.print_help     = false;
     cmd.fullscreen     = false;
     cmd.listmodes      = false;
+    cmd.listmonitors   = false;
     cmd.wnd_border     = true;
     cmd.wnd_resize     = true;
     cmd.grab_mouse     = false;
@@ -238,6 +248,7 @@ int main(int argc, char* argv[])
         << "--help\t\t\tPrint this help\n"
         << "--fullscreen\t\tChange into fullscreen\n"
         << "--list-modes\t\tList available video modes\n"
+        << "--list-monitors\t\tList monitors and their modes\n"
         << "--wnd-no-border\t\tDisable window border\n"
         << "--wnd-no-resize\t\tDisable window resizing\n"
         << "--wnd-no-move\t\tDisable window moving\n"
@@ -258,6 +269,22 @@ int main(int argc, char* argv[])
         return 0;
     }
 
+    if (cmd.listmonitors)
+    {
+        for (auto& monitor : wdk::ListMonitors())
+        {
+            std::cout << monitor.name << (monitor.primary ? " (primary)" : "") << ": "
+                      << monitor.width << "x" << monitor.height
+                      << "+" << monitor.x << "+" << monitor.y << " "
+                      << monitor.current << "\n";
+
+            std::sort(monitor.modes.begin(), monitor.modes.end(), std::greater<wdk::MonitorMode>());
+            for (const auto& mode : monitor.modes)
+                std::cout << "  " << mode << "\n";
+        }
+        return 0;
+    }
+
     wdk::TemporaryVideoModeChange vidmode;
 
     if (cmd.mode.IsValid())
@@ -265,6 +292,7 @@ int main(int argc, char* argv[])
 
     wdk::Window win;
     win.OnCreate     = handle_window_create;
+    win.OnShow       = handle_window_show;
     win.OnLostFocus  = handle_window_lost_focus;
     win.OnGainFocus  = handle_window_gain_focus;
     win.OnResize     = handle_window_resize;
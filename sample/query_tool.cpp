@@ -4,6 +4,7 @@
 
 #include "wdk/opengl/context.h"
 #include "wdk/opengl/config.h"
+#include "wdk/system.h"
 
 # define GL_GLEXT_PROTOTYPES
 #include "glcorearb.h"
@@ -54,6 +55,13 @@ int main(int argc, char* argv[])
             glGetString(GL_RENDERER));        
         print_integer("GL_MAX_VARYING_VECTORS", GL_MAX_VARYING_VECTORS);
         print_integer("GL_MAX_VARYING_COMPONENTS", GL_MAX_VARYING_COMPONENTS);
+
+        const auto& timings = wdk::GetDisplayTimings();
+        std::printf("\nDisplay setup (us):\n");
+        std::printf("%-20s = %d\n", "open", (int)timings.open.count());
+        std::printf("%-20s = %d\n", "atoms", (int)timings.atoms.count());
+        std::printf("%-20s = %d\n", "keyboard", (int)timings.keyboard.count());
+        std::printf("%-20s = %d\n", "randr", (int)timings.randr.count());
     }
     catch (const std::exception& e)
     {
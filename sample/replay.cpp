@@ -0,0 +1,181 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+
+#include "wdk/system.h"
+#include "wdk/window.h"
+#include "wdk/events.h"
+#include "wdk/recorder.h"
+
+// Record the events of a window into a file and play them back
+// through the normal window event processing.
+//
+// replay --record events.bin
+// replay --play events.bin [--real-time] [--repeat N]
+
+struct cmdline {
+    bool print_help = false;
+    bool record     = false;
+    bool play       = false;
+    bool real_time  = false;
+    unsigned repeat = 1;
+    const char* file = nullptr;
+};
+
+bool parse_cmdline(int argc, char* argv[], cmdline& cmd)
+{
+    for (int i=1; i<argc; ++i)
+    {
+        const char* name = argv[i];
+
+        if (!strcmp(name, "--help"))
+            cmd.print_help = true;
+        else if (!strcmp(name, "--real-time"))
+            cmd.real_time = true;
+        else
+        {
+            if (!(i + 1 < argc))
+                return false;
+
+            if (!strcmp(name, "--record"))
+            {
+                cmd.record = true;
+                cmd.file   = argv[++i];
+            }
+            else if (!strcmp(name, "--play"))
+            {
+                cmd.play = true;
+                cmd.file = argv[++i];
+            }
+            else if (!strcmp(name, "--repeat"))
+                cmd.repeat = atoi(argv[++i]);
+            else return false;
+        }
+    }
+    return cmd.print_help || (cmd.record != cmd.play);
+}
+
+int record(const cmdline& cmd)
+{
+    wdk::EventRecorder recorder(cmd.file);
+
+    wdk::Window win;
+    win.OnWantClose = [&](const wdk::WindowEventWantClose&) {
+        win.Destroy();
+    };
+    win.Create("Recording (close window to stop)", 640, 480, 0);
+
+    while (win.DoesExist())
+    {
+        wdk::native_event_t event;
+        wdk::WaitEvent(event);
+        recorder.Record(event);
+        win.ProcessEvent(event);
+    }
+    recorder.Flush();
+
+    std::cout << "Recorded " << recorder.GetEventCount() << " events\n";
+    return 0;
+}
+
+int play(const cmdline& cmd)
+{
+    wdk::EventPlayer player(cmd.file);
+    player.SetTiming(cmd.real_time
+        ? wdk::EventPlayer::Timing::RealTime
+        : wdk::EventPlayer::Timing::AsFastAsPossible);
+
+    unsigned callbacks = 0;
+
+    wdk::Window win;
+    win.OnPaint      = [&](const wdk::WindowEventPaint&)      { ++callbacks; };
+    win.OnResize     = [&](const wdk::WindowEventResize&)     { ++callbacks; };
+    win.OnKeyDown    = [&](const wdk::WindowEventKeyDown&)    { ++callbacks; };
+    win.OnKeyUp      = [&](const wdk::WindowEventKeyUp&)      { ++callbacks; };
+    win.OnChar       = [&](const wdk::WindowEventChar&)       { ++callbacks; };
+    win.OnMouseMove  = [&](const wdk::WindowEventMouseMove&)  { ++callbacks; };
+    win.OnMousePress = [&](const wdk::WindowEventMousePress&) { ++callbacks; };
+    win.OnMouseRelease = [&](const wdk::WindowEventMouseRelease&) { ++callbacks; };
+    win.Create("Playback", 640, 480, 0);
+
+    player.SetWindow(win.GetNativeHandle());
+
+    unsigned events = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i=0; i<cmd.repeat; ++i)
+    {
+        wdk::native_event_t event;
+        while (player.NextEvent(event))
+        {
+            win.ProcessEvent(event);
+            ++events;
+        }
+        player.Rewind();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const auto secs = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "Played back " << events << " events (" << callbacks << " callbacks) "
+              << "in " << secs << " s, "
+              << (secs > 0.0 ? events / secs : 0.0) << " events/s\n";
+
+    win.Destroy();
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    cmdline cmd;
+    if (!parse_cmdline(argc, argv, cmd))
+    {
+        std::cerr << "Incorrect command line\n";
+        return 1;
+    }
+    else if (cmd.print_help)
+    {
+        std::cout
+        << "\n"
+        << "--help\t\t\tPrint this help\n"
+        << "--record file\t\tRecord window events into a file\n"
+        << "--play file\t\tPlay back the events from a file\n"
+        << "--real-time\t\tPlay back with the recorded timing\n"
+        << "--repeat N\t\tPlay back the events N times\n\n";
+        return 0;
+    }
+
+    try
+    {
+        if (cmd.record)
+            return record(cmd);
+        return play(cmd);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+    return 1;
+}
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <X11/Xlib.h>
+#include <atomic>
 
 namespace wdk
 {
@@ -30,12 +31,16 @@ namespace wdk
 // see the extended window manager hints here.
 // http://standards.freedesktop.org/wm-spec/wm-spec-latest.html
 
-extern Atom _NET_WM_STATE;
-extern Atom _NET_WM_STATE_FULLSCREEN;
-extern Atom _MOTIF_WM_HINTS;
+// The atoms are interned on each display connection when it's opened.
+struct display_atoms {
+    Atom _NET_WM_STATE = 0;
+    Atom _NET_WM_STATE_FULLSCREEN = 0;
+    Atom _MOTIF_WM_HINTS = 0;
+    Atom _NET_FRAME_EXTENTS = 0;
 
-extern Atom WM_SIZE_HINTS;
-extern Atom WM_DELETE_WINDOW;
+    Atom WM_SIZE_HINTS = 0;
+    Atom WM_DELETE_WINDOW = 0;
+};
 
 // if these are "extern long const" they appear as undefined references *and* defined references.
 // causing linker errors later. smells like an issue in the toolchain!?!
@@ -47,7 +52,13 @@ extern long _NET_WM_STATE_REMOVE;
 extern long _NET_WM_STATE_ADD;
 extern long _NET_WM_STATE_TOGGLE;
 
-extern int AltMask;
-extern int XRandREventBase;
+// The extension codes are assigned by the server so they're the same
+// for all the connections. They're atomic since any of the display
+// threads can be the one that initializes them.
+
+// XRandR extension event base, 0 when not initialized.
+extern std::atomic<int> XRandREventBase;
+// XInput2 extension major opcode, 0 when not initialized.
+extern std::atomic<int> XInputOpcode;
 
 } // wdk
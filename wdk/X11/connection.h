@@ -0,0 +1,158 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#pragma once
+
+#include <X11/Xlib.h>
+#include <X11/extensions/Xrandr.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "wdk/display.h"
+#include "wdk/monitor.h"
+#include "wdk/keys.h"
+#include "wdk/X11/atoms.h"
+
+namespace wdk
+{
+    struct keycode_mapping {
+        // the wdk keysym for the key without modifiers.
+        Keysym wdk = Keysym::None;
+        // the unicode character for the key without and with shift or -1 if none.
+        long ucs[2] = {-1, -1};
+        // true if the key is on the keypad and is affected by num lock.
+        bool keypad = false;
+    };
+
+    // XRandR screen state cached by the video mode functions. Querying
+    // it can make the server probe the outputs which takes a long time
+    // on some drivers, so it's kept until the screen configuration changes.
+    struct randr_cache {
+        // the connection's randr_generation when the state was queried.
+        unsigned generation = 0;
+        bool valid = false;
+        // the screen resources (RandR 1.2 and later).
+        XRRScreenResources* resources = nullptr;
+        // the output that the video mode functions use, i.e. the primary
+        // output or the first connected output with a CRTC, and its CRTC.
+        XRROutputInfo* output = nullptr;
+        XRRCrtcInfo* crtc = nullptr;
+        RROutput output_id = 0;
+        // all the connected monitors, built on first use.
+        std::vector<Monitor> monitors;
+        bool monitors_valid = false;
+        // the legacy screen configuration. it's only queried for changing
+        // the video mode or when the server is older than RandR 1.2.
+        XRRScreenConfiguration* config = nullptr;
+
+        randr_cache() = default;
+       ~randr_cache()
+        { clear(); }
+
+        void clear()
+        {
+            if (crtc)
+                XRRFreeCrtcInfo(crtc);
+            if (output)
+                XRRFreeOutputInfo(output);
+            if (resources)
+                XRRFreeScreenResources(resources);
+            if (config)
+                XRRFreeScreenConfigInfo(config);
+            crtc      = nullptr;
+            output    = nullptr;
+            resources = nullptr;
+            config    = nullptr;
+            output_id = 0;
+            valid     = false;
+            monitors.clear();
+            monitors_valid = false;
+        }
+
+        randr_cache(const randr_cache&) = delete;
+        randr_cache& operator=(const randr_cache&) = delete;
+    };
+
+    // Key translation tables built from the keyboard mapping.
+    struct keyboard_tables {
+        // keyboard modifier masks for alt and num lock.
+        unsigned alt_mask = 0;
+        unsigned numlock_mask = 0;
+        // keycode to key translation table. X keycodes are always in the range [8, 255].
+        keycode_mapping keycodes[256];
+    };
+
+    // State of a connection opened by wdk::Display. A connection is
+    // normally only used by one thread at a time. The exception is the
+    // default display while the event router is running (see
+    // SetWindowThreadAffinity). The router reads the events on its own
+    // thread, so the state that the events update (the keyboard tables
+    // and the XRandR generation) can be read from other threads at the
+    // same time.
+    struct connection {
+        ::Display* display = nullptr;
+
+        display_atoms atoms;
+
+        // the current keyboard tables or null until they're built on first use.
+        // a mapping change builds a new set of tables and swaps it in so that
+        // a thread translating a key never sees a partially built table.
+        std::atomic<const keyboard_tables*> keyboard {nullptr};
+        // every set of tables that has been built. the replaced tables
+        // are kept until the connection is closed since another thread
+        // may still be reading them. the keyboard mapping rarely changes.
+        std::vector<std::unique_ptr<keyboard_tables>> keyboard_history;
+        // serializes building the tables.
+        std::mutex keyboard_mutex;
+
+        // true once XRandR has been initialized on this connection.
+        // read by the event router while another thread initializes it.
+        std::atomic<bool> randr_ready {false};
+        // the XRandR version supported by the server.
+        int randr_major = 0;
+        int randr_minor = 0;
+        // incremented whenever the screen configuration changes which
+        // invalidates the cached state. the events can be read on
+        // another thread (see SetWindowThreadAffinity) than the one
+        // using the cache, hence atomic.
+        std::atomic<unsigned> randr_generation {0};
+        randr_cache randr;
+
+        // the window that is in relative mouse mode if any. the raw motion
+        // is selected on the root window so only one window on the
+        // connection can have it at a time. read by the event router.
+        std::atomic<unsigned long> relative_mouse_window {0};
+
+        DisplayTimings timings;
+    };
+
+    // Find the state of the connection opened by wdk::Display.
+    // Throws std::runtime_error if the connection isn't known.
+    connection& GetConnection(::Display* dpy);
+
+    // Get the state of the default display's connection.
+    connection& GetDefaultConnection();
+
+} // wdk
@@ -0,0 +1,210 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include <X11/Xlib.h>
+
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "wdk/display.h"
+#include "wdk/X11/connection.h"
+
+namespace {
+    using timing_clock = std::chrono::steady_clock;
+
+    std::chrono::microseconds ElapsedSince(timing_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(timing_clock::now() - start);
+    }
+
+    // connections opened by wdk::Display.
+    struct connection_registry {
+        std::mutex mutex;
+        std::vector<wdk::connection*> connections;
+        // the default display's connection once it has been looked up.
+        // it's checked without the lock since it's the common case.
+        std::atomic<wdk::connection*> default_connection {nullptr};
+    };
+
+    connection_registry& GetRegistry()
+    {
+        static connection_registry registry;
+        return registry;
+    }
+
+    // Intern all the atoms with a single round trip. The atoms are
+    // created if they don't exist yet so that the property
+    // notifications match once a window manager sets them.
+    void InternAtoms(::Display* d, wdk::display_atoms& atoms)
+    {
+        struct {
+            const char* name;
+            Atom* atom;
+        } names[] = {
+            {"WM_DELETE_WINDOW",         &atoms.WM_DELETE_WINDOW},
+            {"WM_SIZE_HINTS",            &atoms.WM_SIZE_HINTS},
+            {"_MOTIF_WM_HINTS",          &atoms._MOTIF_WM_HINTS},
+            {"_NET_WM_STATE",            &atoms._NET_WM_STATE},
+            {"_NET_WM_STATE_FULLSCREEN", &atoms._NET_WM_STATE_FULLSCREEN},
+            {"_NET_FRAME_EXTENTS",       &atoms._NET_FRAME_EXTENTS}
+        };
+        const int num_atoms = sizeof(names) / sizeof(names[0]);
+
+        char* strings[num_atoms];
+        Atom values[num_atoms];
+        for (int i=0; i<num_atoms; ++i)
+            strings[i] = const_cast<char*>(names[i].name);
+
+        if (!XInternAtoms(d, strings, num_atoms, False, values))
+            throw std::runtime_error("failed to intern atoms");
+
+        for (int i=0; i<num_atoms; ++i)
+            *names[i].atom = values[i];
+    }
+
+} // namespace
+
+namespace wdk
+{
+
+struct Display::impl {
+    connection conn;
+    std::mutex close_mutex;
+    std::vector<std::function<void ()>> close_handlers;
+};
+
+Display::Display() : pimpl_(new impl)
+{
+    // Xlib needs to be told before anything else is done with it
+    // that the connections will be used from multiple threads.
+    static std::once_flag threads_once;
+    std::call_once(threads_once, [] {
+        if (!XInitThreads())
+            throw std::runtime_error("XInitThreads failed");
+    });
+
+    connection& conn = pimpl_->conn;
+
+    auto start = timing_clock::now();
+
+    ::Display* d = XOpenDisplay(nullptr);
+    if (!d)
+        throw std::runtime_error("cannot open X display");
+
+    conn.display = d;
+    conn.timings.open = ElapsedSince(start);
+
+    // set masks on our root window handle.
+    // StructureNotifyMask means that we receive events that pertain to
+    // root window's structure changes such as ConfigureNotify.
+    // SubstructureNotifyMask means that we get events that pertain to
+    // child windows of the root window, i.e. create/destroy events.
+    // (our windows are children of the root)
+    XSelectInput(d, RootWindow(d, DefaultScreen(d)), StructureNotifyMask | SubstructureNotifyMask);
+
+    start = timing_clock::now();
+    try
+    {
+        InternAtoms(d, conn.atoms);
+    }
+    catch (...)
+    {
+        XCloseDisplay(d);
+        throw;
+    }
+    conn.timings.atoms = ElapsedSince(start);
+
+    connection_registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.connections.push_back(&conn);
+}
+
+Display::~Display()
+{
+    for (const auto& handler : pimpl_->close_handlers)
+        handler();
+
+    connection& conn = pimpl_->conn;
+    {
+        connection_registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        auto& list = registry.connections;
+        list.erase(std::find(list.begin(), list.end(), &conn));
+        if (registry.default_connection.load() == &conn)
+            registry.default_connection.store(nullptr);
+    }
+    XCloseDisplay(conn.display);
+}
+
+native_display_t Display::GetNativeHandle() const
+{
+    return pimpl_->conn.display;
+}
+
+DisplayTimings Display::GetTimings() const
+{
+    return pimpl_->conn.timings;
+}
+
+void Display::AddCloseHandler(std::function<void ()> handler)
+{
+    std::lock_guard<std::mutex> lock(pimpl_->close_mutex);
+    pimpl_->close_handlers.push_back(std::move(handler));
+}
+
+Display& Display::GetDefault()
+{
+    static Display display;
+    return display;
+}
+
+connection& GetConnection(::Display* dpy)
+{
+    connection_registry& registry = GetRegistry();
+
+    connection* def = registry.default_connection.load(std::memory_order_acquire);
+    if (def && def->display == dpy)
+        return *def;
+
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto* conn : registry.connections)
+    {
+        if (conn->display == dpy)
+            return *conn;
+    }
+    throw std::runtime_error("not a wdk display connection");
+}
+
+connection& GetDefaultConnection()
+{
+    static connection& conn = [] () -> connection& {
+        connection& conn = GetConnection(Display::GetDefault().GetNativeHandle());
+        GetRegistry().default_connection.store(&conn, std::memory_order_release);
+        return conn;
+    }();
+    return conn;
+}
+
+} // wdk
@@ -23,67 +23,283 @@
 #pragma once
 
 #include <X11/Xlib.h>
-#include <cstring>
-#include <stack>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cassert>
 
 namespace wdk
 {
-    // replace the current global error handler in this scope
-    // with an error handler that grabs the error code and 
-    // stores it into a variable for later inspection.    
-    class scoped_error_grabber
+    // Errors of a range of requests identified by the display connection
+    // and the sequence numbers of the requests. The sequence numbers are
+    // per connection so the same serial can be in flight on another display.
+    struct error_range {
+        ::Display* dpy = nullptr;
+        // the first and the last request in the range.
+        // until the range is closed it includes all new requests.
+        unsigned long first = 0;
+        unsigned long last  = 0;
+        bool closed = false;
+        // error code of the first failed request in the range.
+        int error_code = 0;
+    };
+
+    // Holds the display lock so that no other thread can make requests
+    // on the connection in the meantime. The lock can be nested.
+    class scoped_display_lock
+    {
+    public:
+        scoped_display_lock(::Display* dpy) : dpy_(dpy)
+        { XLockDisplay(dpy_); }
+       ~scoped_display_lock()
+        { unlock(); }
+        void unlock()
+        {
+            if (dpy_)
+                XUnlockDisplay(dpy_);
+            dpy_ = nullptr;
+        }
+        scoped_display_lock(const scoped_display_lock&) = delete;
+        scoped_display_lock& operator=(const scoped_display_lock&) = delete;
+    private:
+        ::Display* dpy_;
+    };
+
+    // Process wide X error handler. Instead of swapping the error handler
+    // around every request (and syncing to make sure the errors arrive while
+    // it's installed) the handler is installed once and the errors are matched
+    // to the request ranges registered for the display that the error came from
+    // by their serial numbers. The errors that don't belong to any range go to
+    // the previously installed handler. The display is locked while a range
+    // is open so that a range only has the requests of the thread that opened
+    // it even when several threads share the connection.
+    class error_tracker
     {
-        typedef int (*error_routine)(Display*, XErrorEvent*);
+        typedef int (*error_routine)(::Display*, XErrorEvent*);
     public:
-        scoped_error_grabber() : current_error_code(0), previous_error_callback(nullptr)
+        static error_tracker& get()
         {
-            previous_error_callback = (error_routine)XSetErrorHandler(error_callback);
+            static error_tracker tracker;
+            return tracker;
+        }
 
-            grabbers().push(this);
+        void add(error_range* range)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ranges_[range->dpy].push_back(range);
         }
-       ~scoped_error_grabber()
+        void remove(error_range* range)
         {
-            XSetErrorHandler(previous_error_callback);
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = ranges_.find(range->dpy);
+            assert(it != ranges_.end());
+            auto& list = it->second;
+            list.erase(std::find(list.begin(), list.end(), range));
+            // a closed display's address can be reused by a new connection.
+            if (list.empty())
+                ranges_.erase(it);
+        }
+        void close(error_range* range)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            range->last   = NextRequest(range->dpy) - 1;
+            range->closed = true;
+        }
+        // wait until the server has processed all the requests in the
+        // range and return the error code of the first failed request or 0.
+        // The range must be closed.
+        int wait(error_range* range)
+        {
+            // a single sync covers all the ranges that are waiting
+            // and nothing is needed if the server is already past the range.
+            if (LastKnownRequestProcessed(range->dpy) < range->last)
+                XSync(range->dpy, False);
 
-            grabbers().pop();
+            std::lock_guard<std::mutex> lock(mutex_);
+            return range->error_code;
         }
-        bool has_error() const
+
+        // Open a batch for the display on the calling thread. While the batch
+        // is open the factories on this thread don't check for errors and the
+        // errors of their requests go to the batch.
+        void begin_batch(::Display* dpy)
         {
-            return bool(current_error_code != 0);
+            std::unique_ptr<error_batch> batch(new error_batch);
+            batch->dpy    = dpy;
+            batch->thread = std::this_thread::get_id();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            assert(find_batch(dpy) == batches_.end() && "resource batches can't be nested");
+            batches_.push_back(std::move(batch));
         }
-        int code() const
+        // Hand a closed range over to the calling thread's batch.
+        // The range must have been added already.
+        void add_to_batch(std::unique_ptr<error_range> range)
         {
-            return current_error_code;
+            std::lock_guard<std::mutex> lock(mutex_);
+            assert(range->closed);
+            auto it = find_batch(range->dpy);
+            assert(it != batches_.end());
+            (*it)->ranges.push_back(std::move(range));
         }
-        void clear()
+        // Close the calling thread's batch for the display and wait for its
+        // requests to be processed. Returns the error code of the first
+        // failed request or 0.
+        int end_batch(::Display* dpy)
         {
-            current_error_code = 0;
+            std::unique_ptr<error_batch> batch;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = find_batch(dpy);
+                if (it == batches_.end())
+                    return 0;
+                batch = std::move(*it);
+                batches_.erase(it);
+            }
+            int error = 0;
+            // the ranges are in the request order so waiting
+            // for the last one syncs them all.
+            if (!batch->ranges.empty())
+                wait(batch->ranges.back().get());
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (const auto& range : batch->ranges)
+                {
+                    if (!error)
+                        error = range->error_code;
+                }
+            }
+            for (const auto& range : batch->ranges)
+                remove(range.get());
+            return error;
+        }
+        bool in_batch(::Display* dpy) const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return find_batch(dpy) != batches_.end();
         }
+
     private:
-        static std::stack<scoped_error_grabber*>& grabbers()
+        // The requests made in a resource batch. The batch only has the
+        // ranges of the creations made on the thread that opened it.
+        struct error_batch {
+            ::Display* dpy = nullptr;
+            std::thread::id thread;
+            std::vector<std::unique_ptr<error_range>> ranges;
+        };
+        using batch_list = std::vector<std::unique_ptr<error_batch>>;
+
+        // find the calling thread's batch for the display.
+        batch_list::const_iterator find_batch(::Display* dpy) const
+        {
+            const auto thread = std::this_thread::get_id();
+            return std::find_if(batches_.begin(), batches_.end(),
+                [=](const std::unique_ptr<error_batch>& batch) {
+                    return batch->dpy == dpy && batch->thread == thread;
+                });
+        }
+        batch_list::iterator find_batch(::Display* dpy)
         {
-            static std::stack<scoped_error_grabber*> grabbers;
-            return grabbers;
+            const auto thread = std::this_thread::get_id();
+            return std::find_if(batches_.begin(), batches_.end(),
+                [=](const std::unique_ptr<error_batch>& batch) {
+                    return batch->dpy == dpy && batch->thread == thread;
+                });
         }
-        static int error_callback(Display* dpy, XErrorEvent* err)
+
+        error_tracker()
         {
-            scoped_error_grabber* topmost = grabbers().top();
+            previous_ = (error_routine)XSetErrorHandler(error_callback);
+        }
 
-            topmost->current_error_code = err->error_code;
+        static int error_callback(::Display* dpy, XErrorEvent* err)
+        {
+            error_tracker& tracker = get();
+            {
+                std::lock_guard<std::mutex> lock(tracker.mutex_);
+                // only the ranges of the display the error came from.
+                const auto display = tracker.ranges_.find(dpy);
+                if (display != tracker.ranges_.end())
+                {
+                    const auto& ranges = display->second;
+                    // the latest range is the most specific one.
+                    for (auto it = ranges.rbegin(); it != ranges.rend(); ++it)
+                    {
+                        error_range* range = *it;
+                        assert(range->dpy == dpy);
+                        if (err->serial < range->first)
+                            continue;
+                        if (range->closed && err->serial > range->last)
+                            continue;
 
+                        if (!range->error_code)
+                            range->error_code = err->error_code;
+                        return 0;
+                    }
+                }
+            }
+            if (tracker.previous_)
+                return tracker.previous_(dpy, err);
             return 0;
-        }        
+        }
 
-        int current_error_code;
-        error_routine previous_error_callback;
+        mutable std::mutex mutex_;
+        // the open ranges of each display in the order they were added.
+        std::unordered_map<::Display*, std::vector<error_range*>> ranges_;
+        // the open resource batches, at most one for each thread and display.
+        batch_list batches_;
+        error_routine previous_ = nullptr;
+    };
+
+    // Collect the errors of the requests issued during the lifetime of
+    // this object (or until close) into an error_range. The display is
+    // locked until the range is closed.
+    class scoped_error_range
+    {
+    public:
+        scoped_error_range(::Display* dpy) : lock_(dpy)
+        {
+            range_.dpy   = dpy;
+            range_.first = NextRequest(dpy);
+            error_tracker::get().add(&range_);
+        }
+       ~scoped_error_range()
+        {
+            lock_.unlock();
+            error_tracker::get().remove(&range_);
+        }
+        // stop collecting errors for the requests issued after this.
+        void close()
+        {
+            error_tracker::get().close(&range_);
+            lock_.unlock();
+        }
+        // wait for the requests to be processed and return the
+        // error code of the first failed request or 0.
+        int wait()
+        {
+            if (!range_.closed)
+                close();
+            return error_tracker::get().wait(&range_);
+        }
+        scoped_error_range(const scoped_error_range&) = delete;
+        scoped_error_range& operator=(const scoped_error_range&) = delete;
+    private:
+        scoped_display_lock lock_;
+        error_range range_;
     };
 
     template<typename T>
     class factory
     {
     public:
-        factory(Display* dpy) : dpy_(dpy),
-            has_error_(false), error_code_(0)
+        // If allow_batch is false the creation is always checked
+        // right away even when a resource batch is open.
+        factory(::Display* dpy, bool allow_batch = true) : dpy_(dpy),
+            allow_batch_(allow_batch), has_error_(false), error_code_(0)
         {
         }
         template<typename FactoryFunc>
@@ -92,19 +308,40 @@ namespace wdk
             has_error_  = false;
             error_code_ = 0;
 
-            XSync(dpy_, False);
+            error_tracker& tracker = error_tracker::get();
 
-            scoped_error_grabber grabber;
+            // the errors are checked for the whole batch at once.
+            if (allow_batch_ && tracker.in_batch(dpy_))
+            {
+                std::unique_ptr<error_range> range(new error_range);
+                range->dpy = dpy_;
 
-            T ret = construct_new_t(dpy_);
+                // the range is registered before the requests are made
+                // since another thread can read the errors any time.
+                scoped_display_lock lock(dpy_);
+                range->first = NextRequest(dpy_);
+                tracker.add(range.get());
+                try
+                {
+                    T ret = construct_new_t(dpy_);
+                    tracker.close(range.get());
+                    lock.unlock();
+                    tracker.add_to_batch(std::move(range));
+                    return ret;
+                }
+                catch (...)
+                {
+                    tracker.remove(range.get());
+                    throw;
+                }
+            }
 
-            XSync(dpy_, False);
+            scoped_error_range range(dpy_);
 
-            if (grabber.has_error())
-            {
-                has_error_ = true;
-                error_code_ = grabber.code();                
-            }
+            T ret = construct_new_t(dpy_);
+
+            error_code_ = range.wait();
+            has_error_  = error_code_ != 0;
             return ret;
         }
 
@@ -117,7 +354,8 @@ namespace wdk
             return error_code_;
         }
     private:
-        Display* dpy_;
+        ::Display* dpy_;
+        bool allow_batch_;
         bool has_error_;
         int  error_code_;
     };
@@ -0,0 +1,268 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#pragma once
+
+#include <X11/Xlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace wdk
+{
+    // private event type for events posted with PostUserEvent.
+    // core protocol events are below LASTEvent and extension
+    // events start from 64 so this doesn't collide with either.
+    const int UserEvent = LASTEvent;
+    // private event type for raw mouse motion converted from
+    // the XInput2 raw motion events. see Window::SetRelativeMouseMode.
+    const int RawMotionEvent = LASTEvent + 1;
+
+    // Bounded lock free multiple producer single consumer queue.
+    // Based on Dmitry Vyukov's bounded MPMC queue.
+    // http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+    template<typename T, std::size_t Size>
+    class mpsc_queue
+    {
+        static_assert((Size & (Size - 1)) == 0,
+            "queue size must be a power of two");
+    public:
+        mpsc_queue()
+        {
+            for (std::size_t i=0; i<Size; ++i)
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        mpsc_queue(const mpsc_queue&) = delete;
+        mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+        // push a new value into the queue. can be called from any thread.
+        // returns false if the queue is full.
+        bool push(const T& value)
+        {
+            cell* c = nullptr;
+            std::size_t pos = tail_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                c = &cells_[pos & (Size - 1)];
+                const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+                const std::intptr_t diff = (std::intptr_t)seq - (std::intptr_t)pos;
+                if (diff == 0)
+                {
+                    if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                    return false;
+                else pos = tail_.load(std::memory_order_relaxed);
+            }
+            c->value = value;
+            c->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // pop the oldest value from the queue. must only be called
+        // by the single consumer thread. returns false if the queue is empty.
+        bool pop(T& value)
+        {
+            cell& c = cells_[head_ & (Size - 1)];
+            const std::size_t seq = c.sequence.load(std::memory_order_acquire);
+            if (seq != head_ + 1)
+                return false;
+
+            value = c.value;
+            c.sequence.store(head_ + Size, std::memory_order_release);
+            ++head_;
+            return true;
+        }
+    private:
+        struct cell {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+        cell cells_[Size];
+        alignas(64) std::atomic<std::size_t> tail_ {0};
+        alignas(64) std::size_t head_ = 0;
+    };
+
+    // Bounded wait free single producer single consumer queue.
+    template<typename T, std::size_t Size>
+    class spsc_queue
+    {
+        static_assert((Size & (Size - 1)) == 0,
+            "queue size must be a power of two");
+    public:
+        spsc_queue() = default;
+        spsc_queue(const spsc_queue&) = delete;
+        spsc_queue& operator=(const spsc_queue&) = delete;
+
+        // push a new value into the queue. must only be called by
+        // the single producer thread. returns false if the queue is full.
+        bool push(const T& value)
+        {
+            const std::size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) == Size)
+                return false;
+
+            items_[tail & (Size - 1)] = value;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // pop the oldest value from the queue. must only be called
+        // by the single consumer thread. returns false if the queue is empty.
+        bool pop(T& value)
+        {
+            const std::size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tail_.load(std::memory_order_acquire))
+                return false;
+
+            value = items_[head & (Size - 1)];
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+    private:
+        T items_[Size];
+        alignas(64) std::atomic<std::size_t> head_ {0};
+        alignas(64) std::atomic<std::size_t> tail_ {0};
+    };
+
+    // Unbounded multiple producer single consumer queue. The values go
+    // through the lock free queue until it fills up. After that they spill
+    // into a locked overflow list until the consumer has drained it so that
+    // a slow consumer never blocks the producers. The overflow grows without
+    // a limit while the consumer is not reading. The values pushed by one
+    // producer are popped in the same order.
+    template<typename T, std::size_t Size>
+    class spilling_queue
+    {
+    public:
+        spilling_queue() = default;
+        spilling_queue(const spilling_queue&) = delete;
+        spilling_queue& operator=(const spilling_queue&) = delete;
+
+        // push a new value into the queue. can be called from any thread.
+        void push(const T& value)
+        {
+            // once spilled the values must follow the ones in the
+            // overflow until the consumer has caught up.
+            if (!spilled_.load(std::memory_order_acquire) && queue_.push(value))
+                return;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            overflow_.push_back(value);
+            spilled_.store(true, std::memory_order_release);
+        }
+
+        // pop the oldest value from the queue. must only be called
+        // by the single consumer thread. returns false if the queue is empty.
+        bool pop(T& value)
+        {
+            if (queue_.pop(value))
+                return true;
+            if (!spilled_.load(std::memory_order_acquire))
+                return false;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (overflow_.empty())
+                return false;
+
+            value = overflow_.front();
+            overflow_.pop_front();
+            if (overflow_.empty())
+                spilled_.store(false, std::memory_order_release);
+            return true;
+        }
+    private:
+        mpsc_queue<T, Size> queue_;
+        std::mutex mutex_;
+        std::deque<T> overflow_;
+        std::atomic<bool> spilled_ {false};
+    };
+
+    // eventfd based wakeup for the thread waiting on the event queue.
+    // The eventfd is only written when the wakeup isn't already pending
+    // so that a burst of posts costs a single syscall.
+    class event_wakeup
+    {
+    public:
+        event_wakeup() : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        {
+            if (fd_ == -1)
+                throw std::runtime_error("eventfd failed");
+        }
+       ~event_wakeup()
+        {
+            close(fd_);
+        }
+        event_wakeup(const event_wakeup&) = delete;
+        event_wakeup& operator=(const event_wakeup&) = delete;
+
+        // get the file descriptor to poll on for POLLIN.
+        int fd() const
+        { return fd_; }
+
+        // wake up the waiting thread. can be called from any thread.
+        void signal()
+        {
+            if (pending_.exchange(true))
+                return;
+            const std::uint64_t one = 1;
+            ssize_t ret = write(fd_, &one, sizeof(one));
+            (void)ret;
+        }
+
+        // clear the wakeup. must be called by the waiting thread
+        // before checking its queues again.
+        void clear()
+        {
+            std::uint64_t value;
+            ssize_t ret = read(fd_, &value, sizeof(value));
+            (void)ret;
+            pending_.exchange(false);
+        }
+    private:
+        const int fd_;
+        std::atomic<bool> pending_ {false};
+    };
+
+    // the input events that are read by the input thread when it's running.
+    // see StartInputThread.
+    const long InputEventMask = KeyPressMask | KeyReleaseMask |
+                                ButtonPressMask | ButtonReleaseMask |
+                                PointerMotionMask | ButtonMotionMask;
+
+    // returns true if the input thread is running.
+    bool IsInputThreadRunning();
+
+    // select the input events for the window on the input thread's connection.
+    void SelectInputThreadEvents(::Window window);
+
+    // returns true if the event router is running and reading the
+    // default display's connection. see SetWindowThreadAffinity.
+    bool IsEventRouterRunning();
+
+} // wdk
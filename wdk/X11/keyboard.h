@@ -0,0 +1,48 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#pragma once
+
+#include <X11/Xlib.h>
+#include <utility>
+
+#include "wdk/keys.h"
+#include "wdk/types.h"
+#include "wdk/bitflag.h"
+
+namespace wdk
+{
+    struct connection;
+
+    // Translate the key press into a unicode character using the current
+    // keyboard mapping and modifier state. Returns -1 if the key doesn't
+    // produce a character.
+    long TranslateCharacter(const XKeyEvent& key);
+
+    // Same as the above and TranslateKeydownEvent/TranslateMouseButtonEvent
+    // but with the connection the event was read from. The window already
+    // knows its connection so this saves looking it up by the display.
+    long TranslateCharacter(connection& conn, const XKeyEvent& key);
+    std::pair<bitflag<Keymod>, Keysym> TranslateKeydownEvent(connection& conn, const native_event_t& key);
+    std::pair<bitflag<Keymod>, MouseButton> TranslateMouseButtonEvent(connection& conn, const native_event_t& btn);
+
+} // wdk
@@ -27,13 +27,14 @@
 #include <functional>
 #include <cassert>
 #include "wdk/pixmap.h"
-#include "wdk/system.h"
+#include "wdk/display.h"
 #include "wdk/X11/errorhandler.h"
 
 namespace wdk
 {
 
 struct Pixmap::impl {
+    ::Display* display = nullptr;
     ::Pixmap handle = 0;
     uint_t width = 0;
     uint_t height = 0;
@@ -41,10 +42,14 @@ struct Pixmap::impl {
 };
 
 Pixmap::Pixmap(uint_t width, uint_t height, uint_t visualid)
+    : Pixmap(Display::GetDefault(), width, height, visualid)
+{}
+
+Pixmap::Pixmap(Display& display, uint_t width, uint_t height, uint_t visualid)
 {
     assert(width && height);
 
-    Display* dpy = GetNativeDisplayHandle();
+    ::Display* dpy = display.GetNativeHandle();
 
     XVisualInfo vistemplate = {0};
     vistemplate.visualid    = visualid ? visualid : 0;
@@ -67,6 +72,7 @@ Pixmap::Pixmap(uint_t width, uint_t height, uint_t visualid)
         throw std::runtime_error("failed to create pixmap");
 
     pimpl_.reset(new impl);
+    pimpl_->display = dpy;
     pimpl_->handle = px;
     pimpl_->width  = width;
     pimpl_->height = height;
@@ -87,9 +93,7 @@ Pixmap::Pixmap(uint_t width, uint_t height, uint_t visualid)
 
 Pixmap::~Pixmap()
 {
-    Display* d = GetNativeDisplayHandle();
-
-    XFreePixmap(d, pimpl_->handle);
+    XFreePixmap(pimpl_->display, pimpl_->handle);
 }
 
 native_pixmap_t Pixmap::GetNativeHandle() const
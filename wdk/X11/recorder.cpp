@@ -0,0 +1,250 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include <X11/Xlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+
+#include "wdk/recorder.h"
+#include "wdk/system.h"
+
+namespace {
+
+// The recording is a header followed by fixed size records
+// so that the records can be indexed directly in the mapped file.
+const char MagicBytes[4] = {'W', 'D', 'K', 'E'};
+const std::uint32_t FileVersion = 1;
+
+struct file_header {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t record_size;
+    std::uint32_t reserved;
+    std::uint64_t root_window;
+};
+
+struct event_record {
+    // nanoseconds since the first recorded event
+    std::int64_t time;
+    std::uint32_t samples;
+    std::uint32_t reserved;
+    // the window the event was dispatched to when recorded
+    std::uint64_t window;
+    XEvent event;
+};
+
+void RemapWindow(XEvent& event, ::Window from, ::Window to)
+{
+    auto remap = [=](::Window& w) {
+        if (w == from)
+            w = to;
+    };
+
+    remap(event.xany.window);
+    switch (event.type)
+    {
+        case CreateNotify:    remap(event.xcreatewindow.window);  break;
+        case DestroyNotify:   remap(event.xdestroywindow.window); break;
+        case UnmapNotify:     remap(event.xunmap.window);         break;
+        case MapNotify:       remap(event.xmap.window);           break;
+        case ReparentNotify:  remap(event.xreparent.window);      break;
+        case ConfigureNotify: remap(event.xconfigure.window);     break;
+    }
+}
+
+} // namespace
+
+namespace wdk
+{
+
+struct EventRecorder::impl {
+    std::FILE* file = nullptr;
+    std::size_t count = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+EventRecorder::EventRecorder(const std::string& file) : pimpl_(new impl)
+{
+    pimpl_->file = std::fopen(file.c_str(), "wb");
+    if (!pimpl_->file)
+        throw std::runtime_error("failed to open event recording file");
+
+    file_header header = {};
+    std::memcpy(header.magic, MagicBytes, sizeof(MagicBytes));
+    header.version     = FileVersion;
+    header.record_size = sizeof(event_record);
+    header.root_window = DefaultRootWindow((::Display*)GetNativeDisplayHandle());
+    if (std::fwrite(&header, sizeof(header), 1, pimpl_->file) != 1)
+    {
+        std::fclose(pimpl_->file);
+        throw std::runtime_error("failed to write event recording header");
+    }
+}
+
+EventRecorder::~EventRecorder()
+{
+    std::fclose(pimpl_->file);
+}
+
+void EventRecorder::Record(const native_event_t& ev)
+{
+    if (pimpl_->count == 0)
+        pimpl_->start = ev.get_timestamp();
+
+    event_record record = {};
+    record.time    = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        ev.get_timestamp() - pimpl_->start).count();
+    record.samples = ev.get_sample_count();
+    record.window  = ev.get_window_handle();
+    record.event   = ev.get();
+    // the display pointer is meaningless in the file.
+    record.event.xany.display = nullptr;
+
+    if (std::fwrite(&record, sizeof(record), 1, pimpl_->file) != 1)
+        throw std::runtime_error("failed to write event record");
+
+    pimpl_->count++;
+}
+
+void EventRecorder::Flush()
+{
+    std::fflush(pimpl_->file);
+}
+
+std::size_t EventRecorder::GetEventCount() const
+{
+    return pimpl_->count;
+}
+
+struct EventPlayer::impl {
+    void* base = nullptr;
+    std::size_t size = 0;
+    const file_header* header = nullptr;
+    const event_record* records = nullptr;
+    std::size_t count = 0;
+    std::size_t next  = 0;
+    ::Window window = 0;
+    Timing timing = Timing::AsFastAsPossible;
+    std::chrono::steady_clock::time_point start;
+};
+
+EventPlayer::EventPlayer(const std::string& file) : pimpl_(new impl)
+{
+    const int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error("failed to open event recording file");
+
+    struct stat st;
+    if (::fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(file_header))
+    {
+        ::close(fd);
+        throw std::runtime_error("not a valid event recording");
+    }
+
+    void* base = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+        throw std::runtime_error("failed to map event recording file");
+
+    // the records are read in order
+    ::madvise(base, st.st_size, MADV_SEQUENTIAL);
+
+    const auto* header = static_cast<const file_header*>(base);
+    if (std::memcmp(header->magic, MagicBytes, sizeof(MagicBytes)) ||
+        header->version != FileVersion ||
+        header->record_size != sizeof(event_record))
+    {
+        ::munmap(base, st.st_size);
+        throw std::runtime_error("not a valid event recording");
+    }
+
+    pimpl_->base    = base;
+    pimpl_->size    = st.st_size;
+    pimpl_->header  = header;
+    pimpl_->records = reinterpret_cast<const event_record*>(header + 1);
+    pimpl_->count   = (st.st_size - sizeof(file_header)) / sizeof(event_record);
+}
+
+EventPlayer::~EventPlayer()
+{
+    ::munmap(pimpl_->base, pimpl_->size);
+}
+
+void EventPlayer::SetWindow(native_window_t window)
+{
+    pimpl_->window = window;
+}
+
+void EventPlayer::SetTiming(Timing timing)
+{
+    pimpl_->timing = timing;
+}
+
+bool EventPlayer::NextEvent(native_event_t& ev)
+{
+    if (pimpl_->next == pimpl_->count)
+        return false;
+
+    // the events are stamped with their recorded offsets from
+    // the start of the playback in both timing modes.
+    if (pimpl_->next == 0)
+        pimpl_->start = std::chrono::steady_clock::now();
+
+    const event_record& record = pimpl_->records[pimpl_->next++];
+
+    const auto timestamp = pimpl_->start + std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(std::chrono::nanoseconds(record.time));
+
+    if (pimpl_->timing == Timing::RealTime)
+        std::this_thread::sleep_until(timestamp);
+
+    XEvent event = record.event;
+    event.xany.display = (::Display*)GetNativeDisplayHandle();
+
+    // events for the root window (such as screen changes) are not
+    // remapped to the target window.
+    if (pimpl_->window && record.window && record.window != pimpl_->header->root_window)
+        RemapWindow(event, record.window, pimpl_->window);
+
+    ev = native_event_t(event, record.samples, timestamp);
+    return true;
+}
+
+void EventPlayer::Rewind()
+{
+    pimpl_->next = 0;
+}
+
+std::size_t EventPlayer::GetEventCount() const
+{
+    return pimpl_->count;
+}
+
+} // wdk
@@ -20,28 +20,43 @@
 //  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 //  THE SOFTWARE.
 
-// we're getting a warning about XKeycodeToKeysym. Suppress this for now.
-#if defined(__clang__)
-#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
-#elif defined(__GNUG__)
-#  pragma GCC diagnostic ignored "-Wdeprecated-declarations"
-#endif
-
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
 #include <X11/Xutil.h>
 #include <X11/extensions/Xrandr.h>
+#include <X11/extensions/XInput2.h>
 #include <sys/select.h>
+#include <poll.h>
+#include <cerrno>
 #include <stdexcept>
 #include <algorithm>
 #include <stack>
 #include <chrono>
 #include <thread>
+#include <mutex>
+#include <functional>
+#include <memory>
+#include <unordered_map>
 #include <cassert>
+#include <cstring>
 #include "wdk/system.h"
 #include "wdk/utility.h"
 #include "wdk/videomode.h"
+#include "wdk/monitor.h"
 #include "wdk/keys.h"
+#include "wdk/input.h"
+#include "wdk/X11/eventqueue.h"
+#include "wdk/X11/atoms.h"
+#include "wdk/X11/connection.h"
+#include "wdk/X11/keyboard.h"
+#include "wdk/X11/errorhandler.h"
+
+// g++ -std=gnu++14 defines linux (doh)
+#undef linux
+
+namespace linux {
+    long keysym2ucs(KeySym keysym);
+}// linux
 
 namespace {
 
@@ -51,12 +66,39 @@ namespace {
         Keysym  wdk;
         KeySym  x11;
     };
-    bool operator<(const key_mapping& i, const key_mapping& j)
+    constexpr bool operator<(const key_mapping& i, const key_mapping& j)
     {
         return i.wdk < j.wdk;
     }
 
-    static key_mapping keymap[] = {
+    template<std::size_t N>
+    struct key_table {
+        key_mapping keys[N];
+
+        const key_mapping* begin() const
+        { return keys; }
+        const key_mapping* end() const
+        { return keys + N; }
+    };
+
+    // sort the keymap table for binary lookup on wdk::keysym.
+    // insertion sort is fine here since this is done at compile time.
+    template<std::size_t N>
+    constexpr key_table<N> sort_keymap(const key_mapping (&unsorted)[N])
+    {
+        key_table<N> table = {};
+        for (std::size_t i=0; i<N; ++i)
+        {
+            const key_mapping key = unsorted[i];
+            std::size_t j = i;
+            for (; j > 0 && key < table.keys[j-1]; --j)
+                table.keys[j] = table.keys[j-1];
+            table.keys[j] = key;
+        }
+        return table;
+    }
+
+    constexpr key_mapping unsorted_keymap[] = {
         {Keysym::None,                 NoSymbol},
         {Keysym::Backspace,            XK_BackSpace},
         {Keysym::Tab,                  XK_Tab},
@@ -161,150 +203,966 @@ namespace {
         //{keysym::alt_R,                 XK_ISO_Level3_Shift}
     };
 
-    struct table_sorter {
-        table_sorter()
+    template<std::size_t N>
+    constexpr bool is_sorted(const key_table<N>& table)
+    {
+        for (std::size_t i=1; i<N; ++i)
         {
-            // sort the keymap table for binary lookup on wdk::keysym
-            std::sort(std::begin(keymap), std::end(keymap));
+            if (table.keys[i] < table.keys[i-1])
+                return false;
         }
-    } sort_my_data_bitch;
+        return true;
+    }
+
+    constexpr auto keymap = sort_keymap(unsorted_keymap);
+    static_assert(is_sorted(keymap), "keymap is not sorted");
 
     KeySym find_keysym(Keysym sym)
     {
         assert(sym != Keysym::None);
 
         // binary search the table
-        const auto it = std::lower_bound(std::begin(keymap), std::end(keymap), key_mapping{sym, 0});
+        const auto it = std::lower_bound(keymap.begin(), keymap.end(), key_mapping{sym, 0});
 
         // should be there.
-        assert(it != std::end(keymap));
+        assert(it != keymap.end());
 
         return (*it).x11;
     }
 
+    // Find the modifier masks for the modifiers that don't have constant masks.
+    // The keyboard mapping is the one returned by XGetKeyboardMapping.
+    void FindModifierMasks(::Display* d, keyboard_tables& tables, const KeySym* syms,
+        int syms_per_keycode, int min_keycode, int max_keycode)
+    {
+        tables.alt_mask     = 0;
+        tables.numlock_mask = 0;
+
+        // get the modifier map for finding XK_Alt_L or XK_Alt_R
+        XModifierKeymap* mods = XGetModifierMapping(d);
+        if (!mods)
+            return;
+
+        // there's a maximum of 8 modifiers in X server.
+        // (Shift, Alt, Control, Meta, Super, Hyper, ModeSwitch, NumLock)
+        // but a server can support a variable number of keys
+        // being assigned to any given modifier (max_keypermod)
+        // Alt is the one that we try to find here through XK_Alt_L or XK_Alt_R.
+        // Other interesting modifiers, control and shift are constants
+        for (int mod=0; mod<8; ++mod)
+        {
+            for (int key=0; key<mods->max_keypermod; ++key)
+            {
+                const KeyCode code = mods->modifiermap[mod * mods->max_keypermod + key];
+                if (code < min_keycode || code > max_keycode)
+                    continue;
+
+                // take the first symbol of the first 4 that is assigned.
+                const KeySym* key_syms = &syms[(code - min_keycode) * syms_per_keycode];
+                KeySym sym = NoSymbol;
+                for (int i=0; i<syms_per_keycode && i<4 && sym == NoSymbol; ++i)
+                    sym = key_syms[i];
+
+                if (sym == XK_Alt_L || sym == XK_Alt_R)
+                    tables.alt_mask |= (1 << mod);
+                else if (sym == XK_Num_Lock)
+                    tables.numlock_mask |= (1 << mod);
+            }
+        }
+        XFreeModifiermap(mods);
+    }
 
-unsigned long last_event_received;
+    // Build the keycode table and find the modifier masks
+    // from the current keyboard mapping.
+    void BuildKeyboardTables(::Display* d, keyboard_tables& tables)
+    {
+        int min_keycode = 0;
+        int max_keycode = 0;
+        XDisplayKeycodes(d, &min_keycode, &max_keycode);
 
-} // namespace
+        int syms_per_keycode = 0;
+        KeySym* syms = XGetKeyboardMapping(d, min_keycode, max_keycode - min_keycode + 1,
+            &syms_per_keycode);
+        if (!syms)
+            return;
 
-namespace wdk
-{
+        FindModifierMasks(d, tables, syms, syms_per_keycode, min_keycode, max_keycode);
+
+        for (int code=min_keycode; code<=max_keycode; ++code)
+        {
+            // a keycode without any symbols keeps the empty mapping.
+            if (syms_per_keycode <= 0)
+                continue;
+
+            const KeySym* key = &syms[(code - min_keycode) * syms_per_keycode];
+
+            // the first two symbols are the unshifted and shifted symbols of the
+            // first group. a single symbol stands for both cases of the letter.
+            KeySym lower = key[0];
+            KeySym upper = syms_per_keycode > 1 ? key[1] : NoSymbol;
+            if (upper == NoSymbol)
+                XConvertCase(key[0], &lower, &upper);
+
+            keycode_mapping& map = tables.keycodes[code & 0xff];
+            map.ucs[0] = linux::keysym2ucs(lower);
+            map.ucs[1] = linux::keysym2ucs(upper);
+            map.keypad = IsKeypadKey(lower) || IsKeypadKey(upper);
+
+            if (lower == NoSymbol)
+                continue;
+
+            // the keymap is sorted by wdk keysym so this is a linear search
+            // but it's only done when the keyboard mapping changes.
+            const auto it = std::find_if(keymap.begin(), keymap.end(),
+                [=] (const key_mapping& map)
+                {
+                    return map.x11 == lower;
+                });
+            if (it != keymap.end())
+                map.wdk = it->wdk;
+        }
+        XFree(syms);
+    }
 
-Atom _NET_WM_STATE;
-Atom _NET_WM_STATE_FULLSCREEN;
-Atom _MOTIF_WM_HINTS;
+    using timing_clock = std::chrono::steady_clock;
 
-Atom WM_SIZE_HINTS;
-Atom WM_DELETE_WINDOW;
+    std::chrono::microseconds ElapsedSince(timing_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(timing_clock::now() - start);
+    }
 
-// see comments about the constness in the atoms.h
-long _NET_WM_STATE_REMOVE = 0;
-long _NET_WM_STATE_ADD    = 1;
-long _NET_WM_STATE_TOGGLE = 2;
+    // Build a new set of keyboard tables and make it the current one.
+    // Must be called with the connection's keyboard mutex held.
+    const keyboard_tables& SwapKeyboardTables(connection& conn)
+    {
+        std::unique_ptr<keyboard_tables> tables(new keyboard_tables);
+        BuildKeyboardTables(conn.display, *tables);
 
+        const keyboard_tables* current = tables.get();
+        conn.keyboard_history.push_back(std::move(tables));
+        conn.keyboard.store(current, std::memory_order_release);
+        return *current;
+    }
 
-int AltMask;
-int XRandREventBase;
+    // Build the keyboard tables on first use. Most of the keyboard
+    // setup is round trips to the server that a program that never
+    // looks at the keyboard doesn't need to pay for.
+    const keyboard_tables& InitKeyboard(connection& conn)
+    {
+        if (const keyboard_tables* tables = conn.keyboard.load(std::memory_order_acquire))
+            return *tables;
 
-native_display_t GetNativeDisplayHandle()
-{
-    struct open_display {
-        Display* d;
+        std::lock_guard<std::mutex> lock(conn.keyboard_mutex);
+
+        // another thread could have built them while we were waiting.
+        if (const keyboard_tables* tables = conn.keyboard.load(std::memory_order_acquire))
+            return *tables;
+
+        const auto start = timing_clock::now();
+        const keyboard_tables& tables = SwapKeyboardTables(conn);
+        conn.timings.keyboard = ElapsedSince(start);
+        return tables;
+    }
+
+    // Query the XRandR extension and select the screen change
+    // notifications on first use of the video mode functions.
+    void InitRandR(connection& conn)
+    {
+        if (conn.randr_ready.load(std::memory_order_acquire))
+            return;
+
+        ::Display* d = conn.display;
+
+        const auto start = timing_clock::now();
+
+        int major = 0;
+        int minor = 0;
+        if (!XRRQueryVersion(d, &major, &minor))
+            throw std::runtime_error("XRandR is not available");
+        conn.randr_major = major;
+        conn.randr_minor = minor;
+
+        // get event base
+        int event_base = 0;
+        int error_base = 0;
+        XRRQueryExtension(d, &event_base, &error_base);
+
+        XRandREventBase = event_base;
+
+        // set input mask to get XRandR notifications. with RandR 1.2 a mode
+        // change on a CRTC doesn't necessarily change the screen size so
+        // the CRTC and output changes are needed to keep the cache valid.
+        int mask = RRScreenChangeNotifyMask;
+        if (major > 1 || minor >= 2)
+            mask |= RRCrtcChangeNotifyMask | RROutputChangeNotifyMask;
+        XRRSelectInput(d, RootWindow(d, DefaultScreen(d)), mask);
+
+        conn.timings.randr = ElapsedSince(start);
+        conn.randr_ready.store(true, std::memory_order_release);
+    }
+
+    bool HasRandR12(const connection& conn)
+    {
+        return conn.randr_major > 1 || conn.randr_minor >= 2;
+    }
+
+    const XRRModeInfo* FindModeInfo(const XRRScreenResources* res, RRMode mode)
+    {
+        for (int i=0; i<res->nmode; ++i)
+        {
+            if (res->modes[i].id == mode)
+                return &res->modes[i];
+        }
+        return nullptr;
+    }
+
+    // Get the size of the mode as it appears on the screen.
+    VideoMode GetModeSize(const XRRModeInfo& mode, Rotation rotation)
+    {
+        if (rotation & (RR_Rotate_90 | RR_Rotate_270))
+            return VideoMode(mode.height, mode.width);
+        return VideoMode(mode.width, mode.height);
+    }
+
+    // Find the output that the video mode functions use. This is the
+    // primary output or if there's none the first connected output that
+    // is driven by a CRTC. This is the same output the server uses for
+    // the legacy (RandR 1.1) screen configuration.
+    void FindVideoModeOutput(::Display* d, ::Window root, const connection& conn, randr_cache& cache)
+    {
+        const XRRScreenResources* res = cache.resources;
+
+        RROutput primary = 0;
+        if (conn.randr_major > 1 || conn.randr_minor >= 3)
+            primary = XRRGetOutputPrimary(d, root);
+
+        for (int i=-1; i<res->noutput && !cache.output; ++i)
+        {
+            // try the primary output first.
+            const RROutput id = i == -1 ? primary : res->outputs[i];
+            if (!id || (i >= 0 && id == primary))
+                continue;
+
+            XRROutputInfo* info = XRRGetOutputInfo(d, cache.resources, id);
+            if (!info)
+                continue;
+            if (info->connection == RR_Connected && info->crtc)
+            {
+                cache.output    = info;
+                cache.output_id = id;
+            }
+            else XRRFreeOutputInfo(info);
+        }
+        if (cache.output)
+            cache.crtc = XRRGetCrtcInfo(d, cache.resources, cache.output->crtc);
+    }
+
+    // Get the cached XRandR screen state of the connection.
+    // If the screen configuration has changed since the last time
+    // the state is queried again.
+    randr_cache& GetScreenState(connection& conn)
+    {
+        InitRandR(conn);
+
+        randr_cache& cache = conn.randr;
+
+        // take the generation before querying so that a change
+        // that happens meanwhile invalidates the new state.
+        const unsigned generation = conn.randr_generation.load();
+        if (cache.valid && cache.generation == generation)
+            return cache;
+
+        cache.clear();
+
+        ::Display* d = conn.display;
+        ::Window root = RootWindow(d, DefaultScreen(d));
+
+        if (HasRandR12(conn))
+        {
+            // the current resources are what the server already knows
+            // without probing the outputs. only if it has never probed
+            // them there's nothing to go on and the probe is needed.
+            cache.resources = XRRGetScreenResourcesCurrent(d, root);
+            if (cache.resources && !cache.resources->noutput)
+            {
+                XRRFreeScreenResources(cache.resources);
+                cache.resources = XRRGetScreenResources(d, root);
+            }
+            if (!cache.resources)
+                throw std::runtime_error("Xrandr get screen resources failed");
 
-        open_display() : d(XOpenDisplay(nullptr))
+            FindVideoModeOutput(d, root, conn, cache);
+        }
+        else
+        {
+            cache.config = XRRGetScreenInfo(d, root);
+            if (!cache.config)
+                throw std::runtime_error("Xrandr get config failed");
+        }
+        cache.generation = generation;
+        cache.valid = true;
+        return cache;
+    }
+
+    MonitorMode MakeMonitorMode(const XRRModeInfo& mode, Rotation rotation)
+    {
+        const VideoMode size = GetModeSize(mode, rotation);
+
+        MonitorMode ret;
+        ret.id   = mode.id;
+        ret.xres = size.xres;
+        ret.yres = size.yres;
+
+        // the refresh rate is the pixel clock divided by the total
+        // number of pixels (including the blanking) in a frame.
+        double vtotal = mode.vTotal;
+        if (mode.modeFlags & RR_DoubleScan)
+            vtotal *= 2.0;
+        if (mode.modeFlags & RR_Interlace)
+            vtotal /= 2.0;
+        if (mode.hTotal && vtotal > 0.0)
+            ret.refresh_rate = (double)mode.dotClock / ((double)mode.hTotal * vtotal);
+        return ret;
+    }
+
+    // Get the cached list of connected monitors.
+    const std::vector<Monitor>& GetMonitors(connection& conn)
+    {
+        randr_cache& cache = GetScreenState(conn);
+        if (cache.monitors_valid)
+            return cache.monitors;
+
+        if (!cache.resources)
+            throw std::runtime_error("XRandR 1.2 is not available");
+
+        ::Display* d = conn.display;
+        XRRScreenResources* res = cache.resources;
+
+        for (int i=0; i<res->noutput; ++i)
         {
-            if (!d)
-                throw std::runtime_error("cannot open X display");
-
-            int major, minor;
-            if (!XRRQueryVersion(d, &major, &minor))
-                throw std::runtime_error("XRandR is not available");
-
-            // get event base
-            int event_base = 0;
-            int error_base = 0;
-            XRRQueryExtension(d, &event_base, &error_base);
-
-            XRandREventBase = event_base;
-
-            int root = RootWindow(d, DefaultScreen(d));
-            // set masks on our root window handle.
-            // StructureNotifyMask means that we receive events that pertain to
-            // root window's structure changes such as ConfigureNotify.
-            // SubstructureNotifyMask means that we get events that pertain to
-            // child windows of the root window, i.e. create/destroy events.
-            // (our windows are children of the root)
-            XSelectInput(d, root, StructureNotifyMask | SubstructureNotifyMask);
-
-            // set input mask to get XRandR notifications
-            XRRSelectInput(d, root, RRScreenChangeNotifyMask);
-
-            // get the modifier map for finding XK_Alt_L or XK_Alt_R
-            XModifierKeymap* mods = XGetModifierMapping(d);
-
-            // there's a maximum of 8 modifiers in X server.
-            // (Shift, Alt, Control, Meta, Super, Hyper, ModeSwitch, NumLock)
-            // but a server can support a variable number of keys
-            // being assigned to any given modifier (max_keypermod)
-            // Alt is the one that we try to find here through XK_Alt_L or XK_Alt_R.
-            // Other interesting modifiers, control and shift are constants
-            for (int mod=0; mod<8; ++mod)
+            auto output = MakeUniqueHandle(XRRGetOutputInfo(d, res, res->outputs[i]),
+                XRRFreeOutputInfo);
+            if (!output || output->connection != RR_Connected)
+                continue;
+
+            Monitor monitor;
+            monitor.id      = res->outputs[i];
+            monitor.name.assign(output->name, output->nameLen);
+            monitor.primary = res->outputs[i] == cache.output_id;
+
+            Rotation rotation = RR_Rotate_0;
+            if (output->crtc)
             {
-                for (int key=0; key<mods->max_keypermod; ++key)
+                auto crtc = MakeUniqueHandle(XRRGetCrtcInfo(d, res, output->crtc),
+                    XRRFreeCrtcInfo);
+                if (crtc && crtc->mode)
                 {
-                    const KeyCode code = mods->modifiermap[mod * mods->max_keypermod + key];
-                    KeySym  sym  = NoSymbol;
-                    int group    = 0;
-                    do
-                    {
-                        sym = XKeycodeToKeysym(d, code, group++);
-                    }
-                    while (sym == NoSymbol && group < 4);
-
-                    if (sym == XK_Alt_L)
-                    {
-                        AltMask |= (1 << mod);
-                        //printf("Found LeftAlt mask %x", (1<<mod));
-                    }
-                    else if (sym == XK_Alt_R)
-                    {
-                        AltMask |= (1 << mod);
-                       //printf("Found RightAlt mask %x", (1<<mod));
-                    }
+                    rotation = crtc->rotation;
+                    monitor.x      = crtc->x;
+                    monitor.y      = crtc->y;
+                    monitor.width  = crtc->width;
+                    monitor.height = crtc->height;
+                    if (const XRRModeInfo* mode = FindModeInfo(res, crtc->mode))
+                        monitor.current = MakeMonitorMode(*mode, rotation);
                 }
             }
-            XFreeModifiermap(mods);
+            for (int j=0; j<output->nmode; ++j)
+            {
+                if (const XRRModeInfo* mode = FindModeInfo(res, output->modes[j]))
+                    monitor.modes.push_back(MakeMonitorMode(*mode, rotation));
+            }
+            cache.monitors.push_back(std::move(monitor));
+        }
+        cache.monitors_valid = true;
+        return cache.monitors;
+    }
 
-            WM_DELETE_WINDOW = XInternAtom(d, "WM_DELETE_WINDOW", True);
-            WM_SIZE_HINTS    = XInternAtom(d, "WM_SIZE_HINTS", True);
-            _MOTIF_WM_HINTS  = XInternAtom(d, "_MOTIF_WM_HINTS", True);
-            _NET_WM_STATE    = XInternAtom(d, "_NET_WM_STATE", True);
-            _NET_WM_STATE_FULLSCREEN = XInternAtom(d, "_NET_WM_STATE_FULLSCREEN", True);
+    // Get the legacy screen configuration for changing the video mode.
+    XRRScreenConfiguration* GetScreenConfig(connection& conn)
+    {
+        randr_cache& cache = GetScreenState(conn);
+        if (!cache.config)
+        {
+            ::Display* d = conn.display;
+            cache.config = XRRGetScreenInfo(d, RootWindow(d, DefaultScreen(d)));
+            if (!cache.config)
+                throw std::runtime_error("Xrandr get config failed");
         }
-       ~open_display()
+        return cache.config;
+    }
+
+    // The input state is updated by the thread reading the events
+    // and a snapshot can be taken on any thread.
+    struct InputState {
+        std::mutex mutex;
+        InputSnapshot snapshot;
+    };
+
+    InputState& GetInputState()
+    {
+        static InputState state;
+        return state;
+    }
+
+    // reseed the keyboard state from the key vector as returned
+    // by XQueryKeymap or as carried in a KeymapNotify event.
+    void SeedKeyState(const keyboard_tables& tables, InputSnapshot& state, const char* key_vector)
+    {
+        state.keycodes.reset();
+        state.keys.reset();
+        // X keycodes are always in the range [8, 255].
+        for (unsigned code=8; code<256; ++code)
         {
-            XCloseDisplay(d);
+            if (!(key_vector[code / 8] & (1 << (code % 8))))
+                continue;
+            state.keycodes.set(code);
+            const Keysym key = tables.keycodes[code].wdk;
+            if (key != Keysym::None)
+                state.keys.set(static_cast<unsigned>(key));
+        }
+    }
+
+    // update the tracked input state from the event.
+    // the state is only tracked for the default display.
+    void UpdateInputState(connection& conn, const native_event_t& ev)
+    {
+        const XEvent& event = ev;
+
+        // set up the tables before taking the lock, it can take a round trip.
+        const keyboard_tables* tables = nullptr;
+        if (event.type == KeyPress || event.type == KeyRelease || event.type == KeymapNotify)
+            tables = &InitKeyboard(conn);
+
+        InputState& input = GetInputState();
+        std::lock_guard<std::mutex> lock(input.mutex);
+        InputSnapshot& state = input.snapshot;
+
+        switch (event.type)
+        {
+            case KeyPress:
+            case KeyRelease:
+                {
+                    const bool down = event.type == KeyPress;
+                    const unsigned code = event.xkey.keycode & 0xff;
+                    state.keycodes.set(code, down);
+                    const Keysym key = tables->keycodes[code].wdk;
+                    if (key != Keysym::None)
+                        state.keys.set(static_cast<unsigned>(key), down);
+                }
+                break;
+
+            case ButtonPress:
+            case ButtonRelease:
+                {
+                    // the wheel scroll "buttons" are never held down.
+                    const MouseButton button = TranslateMouseButtonEvent(ev).second;
+                    if (button != MouseButton::None &&
+                        button != MouseButton::WheelScrollUp &&
+                        button != MouseButton::WheelScrollDown)
+                        state.buttons.set(button, event.type == ButtonPress);
+                    state.mouse_window_x = event.xbutton.x;
+                    state.mouse_window_y = event.xbutton.y;
+                    state.mouse_global_x = event.xbutton.x_root;
+                    state.mouse_global_y = event.xbutton.y_root;
+                }
+                break;
+
+            case MotionNotify:
+                state.mouse_window_x = event.xmotion.x;
+                state.mouse_window_y = event.xmotion.y;
+                state.mouse_global_x = event.xmotion.x_root;
+                state.mouse_global_y = event.xmotion.y_root;
+                break;
+
+            // this follows FocusIn (and EnterNotify) and carries the
+            // current keyboard state so there's no need to query it.
+            case KeymapNotify:
+                SeedKeyState(*tables, state, event.xkeymap.key_vector);
+                break;
+
+            // the key releases will go to some other window so we'd
+            // never see them. Focus changes due to our own keyboard
+            // grabs don't matter.
+            case FocusOut:
+                if (event.xfocus.mode == NotifyNormal)
+                {
+                    state.keycodes.reset();
+                    state.keys.reset();
+                    state.buttons.clear();
+                }
+                break;
+        }
+    }
+
+    // read by the event router thread when it's running.
+    std::atomic<bool> CoalesceMouseMove {false};
+
+    using UserEventQueue = mpsc_queue<std::uintptr_t, 1024>;
+
+    UserEventQueue& GetUserEventQueue()
+    {
+        static UserEventQueue queue;
+        return queue;
+    }
+    event_wakeup& GetEventWakeup()
+    {
+        static event_wakeup wakeup;
+        return wakeup;
+    }
+
+    // Read the next user event if any.
+    bool ReadUserEvent(native_event_t& ev)
+    {
+        std::uintptr_t payload;
+        if (!GetUserEventQueue().pop(payload))
+            return false;
+
+        XEvent event = {0};
+        event.xclient.type   = UserEvent;
+        event.xclient.format = 32;
+        event.xclient.data.l[0] = static_cast<long>(payload);
+        ev = native_event_t(event);
+        return true;
+    }
+
+
+    // Push the event into the queue. If the consumer isn't keeping up,
+    // wait for it instead of dropping the event. The events will buffer
+    // in the X connection meanwhile. Returns false if stopped while waiting.
+    template<typename Queue>
+    bool PushEvent(Queue& queue, const native_event_t& ev, const std::atomic<bool>& stop)
+    {
+        while (!queue.push(ev))
+        {
+            if (stop)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    // Event queue of a thread that has windows bound to it.
+    // The event router and the input thread push the events
+    // and the thread that owns the queue pops them. The queue spills
+    // over instead of blocking so that a thread that isn't reading its
+    // events doesn't hold up the router and the other threads.
+    struct ThreadEventQueue {
+        spilling_queue<native_event_t, 512> queue;
+        event_wakeup wakeup;
+    };
+
+    using ThreadEventQueuePtr = std::shared_ptr<ThreadEventQueue>;
+
+    // Get the calling thread's event queue. The window table shares the
+    // queue so that it stays valid for as long as a window is bound to it.
+    const ThreadEventQueuePtr& GetThreadEventQueue()
+    {
+        thread_local ThreadEventQueuePtr queue = std::make_shared<ThreadEventQueue>();
+        return queue;
+    }
+
+    // Table of the windows bound to a thread. It's only looked up
+    // once per event by the router so a plain mutex is enough here.
+    struct WindowAffinity {
+        std::mutex mutex;
+        std::unordered_map<unsigned long, ThreadEventQueuePtr> windows;
+    };
+
+    WindowAffinity& GetWindowAffinity()
+    {
+        static WindowAffinity affinity;
+        return affinity;
+    }
+
+    // Find the queue of the thread that owns the event's window.
+    // Returns nullptr if the window isn't bound to any thread.
+    ThreadEventQueuePtr FindEventThread(const native_event_t& ev)
+    {
+        // the extension events don't have a window in the common header.
+        const XEvent& event = ev;
+        if (event.type == GenericEvent)
+            return nullptr;
+
+        const unsigned long window = ev.get_window_handle();
+        if (!window)
+            return nullptr;
+
+        WindowAffinity& affinity = GetWindowAffinity();
+        std::lock_guard<std::mutex> lock(affinity.mutex);
+
+        const auto it = affinity.windows.find(window);
+        if (it == affinity.windows.end())
+            return nullptr;
+        return it->second;
+    }
+
+    // Push the event into the queue of the thread that owns its window.
+    // Returns false if the window isn't bound to any thread.
+    bool RouteToEventThread(const native_event_t& ev)
+    {
+        const ThreadEventQueuePtr owner = FindEventThread(ev);
+        if (!owner)
+            return false;
+
+        owner->queue.push(ev);
+        owner->wakeup.signal();
+        return true;
+    }
+
+    struct InputThread {
+        // the application's display connection.
+        ::Display* app_display = nullptr;
+        // the input thread's own display connection.
+        ::Display* display = nullptr;
+        // window for waking up the input thread when stopping.
+        ::Window wakeup_window = 0;
+        std::thread thread;
+        std::atomic<bool> running {false};
+        std::atomic<bool> stop {false};
+        spsc_queue<native_event_t, 512> queue;
+
+       ~InputThread()
+        {
+            if (!running)
+                return;
+
+            stop = true;
+            XEvent ev = {0};
+            ev.xclient.type   = ClientMessage;
+            ev.xclient.window = wakeup_window;
+            ev.xclient.format = 32;
+            XSendEvent(display, wakeup_window, False, NoEventMask, &ev);
+            XFlush(display);
+            thread.join();
+            XDestroyWindow(display, wakeup_window);
+            XCloseDisplay(display);
         }
     };
-    static open_display dpy;
 
-    return dpy.d;
+    InputThread& GetInputThread()
+    {
+        static InputThread input;
+        return input;
+    }
+
+    void InputThreadMain(InputThread* input)
+    {
+        for (;;)
+        {
+            XEvent event;
+            XNextEvent(input->display, &event);
+            if (input->stop)
+                return;
+
+            // present the event as if it was read from the application's
+            // display so that nothing touches this connection outside this thread.
+            event.xany.display = input->app_display;
+
+            // the event is timestamped here when the native event is constructed.
+            const native_event_t ev(event);
+
+            // the input for a window bound to a thread goes directly to that thread.
+            if (IsEventRouterRunning() && RouteToEventThread(ev))
+                continue;
+
+            if (!PushEvent(input->queue, ev, input->stop))
+                return;
+            GetEventWakeup().signal();
+        }
+    }
+
+    // Read the next event read by the input thread if any.
+    bool ReadInputEvent(native_event_t& ev)
+    {
+        InputThread& input = GetInputThread();
+        if (!input.running.load(std::memory_order_acquire))
+            return false;
+
+        if (!input.queue.pop(ev))
+            return false;
+
+        UpdateInputState(GetDefaultConnection(), ev);
+        return true;
+    }
+    // Convert an XInput2 raw motion event into the private raw motion
+    // event while the event data is still available. Returns false if
+    // the event was something else.
+    bool ConvertRawMotionEvent(connection& conn, XEvent& event)
+    {
+        ::Display* d = conn.display;
+
+        XGenericEventCookie* cookie = &event.xcookie;
+        if (!XGetEventData(d, cookie))
+            return false;
+
+        double delta[2] = {0.0, 0.0};
+        bool raw_motion = false;
+
+        if (cookie->evtype == XI_RawMotion)
+        {
+            // the raw values are packed, only the valuators
+            // that are set in the mask are present.
+            const auto* raw = static_cast<const XIRawEvent*>(cookie->data);
+            const double* value = raw->raw_values;
+            for (int i=0; i<2 && i<raw->valuators.mask_len * 8; ++i)
+            {
+                if (XIMaskIsSet(raw->valuators.mask, i))
+                    delta[i] = *value++;
+            }
+            raw_motion = true;
+        }
+        XFreeEventData(d, cookie);
+
+        if (!raw_motion)
+            return false;
+
+        std::memset(&event, 0, sizeof(event));
+        event.xclient.type    = RawMotionEvent;
+        event.xclient.display = d;
+        event.xclient.window  = conn.relative_mouse_window;
+        static_assert(sizeof(delta) <= sizeof(event.xclient.data), "");
+        std::memcpy(&event.xclient.data, delta, sizeof(delta));
+        return true;
+    }
+
+    // Read the next event from the display's event queue without
+    // tracking the input state. Will block if there are no events in the queue.
+    void ReadNextEvent(connection& conn, native_event_t& ev)
+    {
+        ::Display* d = conn.display;
+
+        XEvent event = {0};
+        XNextEvent(d, &event);
+
+        // Update Xlib state when XrandR events are received.
+        // The notifications are only selected once XRandR is initialized
+        // and calling this before would initialize the extension.
+        if (conn.randr_ready.load(std::memory_order_acquire))
+        {
+            XRRUpdateConfiguration(&event);
+
+            // the cached screen state is queried again on next use.
+            const int randr_event = event.type - XRandREventBase;
+            if (randr_event == RRScreenChangeNotify || randr_event == RRNotify)
+                ++conn.randr_generation;
+        }
+
+        // update the keyboard mapping when it changes. if the tables
+        // haven't been built yet they'll see the new mapping when they are.
+        if (event.type == MappingNotify && event.xmapping.request != MappingPointer)
+        {
+            XRefreshKeyboardMapping(&event.xmapping);
+            if (conn.keyboard.load(std::memory_order_acquire))
+            {
+                std::lock_guard<std::mutex> lock(conn.keyboard_mutex);
+                SwapKeyboardTables(conn);
+            }
+        }
+
+        // raw motion is only selected when a window is in relative mouse mode.
+        if (event.type == GenericEvent && XInputOpcode &&
+            event.xcookie.extension == XInputOpcode && conn.relative_mouse_window)
+            ConvertRawMotionEvent(conn, event);
+
+        unsigned samples = 1;
+
+        // collapse consecutive motion events for the same window into the latest one.
+        // only look at the events that are already in Xlib's queue, no IO here.
+        if (event.type == MotionNotify && CoalesceMouseMove)
+        {
+            XEvent next;
+            while (XEventsQueued(d, QueuedAlready))
+            {
+                XPeekEvent(d, &next);
+                if (next.type != MotionNotify || next.xmotion.window != event.xmotion.window)
+                    break;
+
+                XNextEvent(d, &event);
+                ++samples;
+            }
+        }
+
+        ev = native_event_t(event, samples);
+    }
+
+    // Read the next event from the display's event queue.
+    // Will block if there are no events in the queue.
+    void ReadEvent(connection& conn, native_event_t& ev)
+    {
+        ReadNextEvent(conn, ev);
+
+        if (&conn == &GetDefaultConnection())
+            UpdateInputState(conn, ev);
+    }
+
+    struct EventRouter {
+        ::Display* display = nullptr;
+        // window for waking up the router when stopping.
+        ::Window wakeup_window = 0;
+        std::thread thread;
+        std::atomic<bool> running {false};
+        std::atomic<bool> stop {false};
+        // threads binding their first windows can start the router at the same time.
+        std::once_flag start;
+        // held while reading the connection directly before the router is
+        // running and by StartEventRouter so that the router can't start
+        // while another thread is in the middle of reading the connection.
+        std::mutex handoff;
+        // the events that don't belong to a bound window. spills over
+        // like the thread queues so that the router never blocks.
+        spilling_queue<native_event_t, 512> queue;
+
+       ~EventRouter()
+        {
+            if (!running)
+                return;
+
+            stop = true;
+            XEvent ev = {0};
+            ev.xclient.type   = ClientMessage;
+            ev.xclient.window = wakeup_window;
+            ev.xclient.format = 32;
+            XSendEvent(display, wakeup_window, False, NoEventMask, &ev);
+            XFlush(display);
+            thread.join();
+            XDestroyWindow(display, wakeup_window);
+            XFlush(display);
+        }
+    };
+
+    EventRouter& GetEventRouter()
+    {
+        // the router uses the default display and the wakeup
+        // so they must be created first in order to outlive it.
+        wdk::Display::GetDefault();
+        GetEventWakeup();
+
+        static EventRouter router;
+        return router;
+    }
+
+    void EventRouterMain(EventRouter* router, connection* conn)
+    {
+        for (;;)
+        {
+            // the input state is tracked when PeekEvent/WaitEvent returns
+            // the event since the snapshot isn't shared with this thread.
+            native_event_t ev;
+            ReadNextEvent(*conn, ev);
+            if (router->stop)
+                return;
+
+            const XEvent& event = ev;
+            if (event.type == ClientMessage && event.xclient.window == router->wakeup_window)
+                continue;
+
+            if (RouteToEventThread(ev))
+                continue;
+
+            router->queue.push(ev);
+            GetEventWakeup().signal();
+        }
+    }
+
+    void StartEventRouter(EventRouter& router)
+    {
+        connection& conn = GetDefaultConnection();
+
+        // build the keyboard tables now so that the threads translating
+        // their keys don't have to make the round trips while the router
+        // is reading. after this they're only rebuilt by the router when
+        // the keyboard mapping changes.
+        InitKeyboard(conn);
+
+        router.display = conn.display;
+        router.wakeup_window = XCreateWindow(conn.display,
+            RootWindow(conn.display, DefaultScreen(conn.display)),
+            0, 0, 1, 1, 0, 0, InputOnly, CopyFromParent, 0, nullptr);
+        XFlush(conn.display);
+
+        std::lock_guard<std::mutex> lock(router.handoff);
+
+        // the events already in Xlib's queue are routed first so that
+        // they're not left behind for a reader that no longer reads.
+        while (XEventsQueued(conn.display, QueuedAlready))
+        {
+            native_event_t ev;
+            ReadNextEvent(conn, ev);
+            if (!RouteToEventThread(ev))
+                router.queue.push(ev);
+        }
+
+        router.stop   = false;
+        router.thread = std::thread(EventRouterMain, &router, &conn);
+        router.running.store(true, std::memory_order_release);
+
+        // wake up a thread that is waiting on the connection
+        // so that it starts waiting on the router instead.
+        GetEventWakeup().signal();
+    }
+
+    // Read the next event routed to PeekEvent/WaitEvent if any.
+    bool ReadRoutedEvent(native_event_t& ev)
+    {
+        if (!IsEventRouterRunning())
+            return false;
+
+        if (!GetEventRouter().queue.pop(ev))
+            return false;
+
+        UpdateInputState(GetDefaultConnection(), ev);
+        return true;
+    }
+
+
+unsigned long last_event_received;
+
+} // namespace
+
+namespace wdk
+{
+
+// see comments about the constness in the atoms.h
+long _NET_WM_STATE_REMOVE = 0;
+long _NET_WM_STATE_ADD    = 1;
+long _NET_WM_STATE_TOGGLE = 2;
+
+
+std::atomic<int> XRandREventBase {0};
+std::atomic<int> XInputOpcode {0};
+
+native_display_t GetNativeDisplayHandle()
+{
+    return Display::GetDefault().GetNativeHandle();
+}
+
+DisplayTimings GetDisplayTimings()
+{
+    return Display::GetDefault().GetTimings();
 }
 
 VideoMode GetCurrentVideoMode()
 {
-    Display* dpy = GetNativeDisplayHandle();
-    int root = RootWindow(dpy, DefaultScreen(dpy));
+    connection& conn = GetDefaultConnection();
+
+    const randr_cache& cache = GetScreenState(conn);
+    if (!cache.config)
+    {
+        if (!cache.crtc || !cache.crtc->mode)
+            throw std::runtime_error("no active output");
 
-    auto config = MakeUniqueHandle(XRRGetScreenInfo(dpy, root), XRRFreeScreenConfigInfo);
-    if (!config)
-        throw std::runtime_error("Xrandr get config failed");
+        const XRRModeInfo* mode = FindModeInfo(cache.resources, cache.crtc->mode);
+        if (!mode)
+            throw std::runtime_error("no such video mode");
+
+        return GetModeSize(*mode, cache.crtc->rotation);
+    }
 
     Rotation rot;
-    const int cur_mode_index = XRRConfigCurrentConfiguration(config.get(), &rot);
+    const int cur_mode_index = XRRConfigCurrentConfiguration(cache.config, &rot);
 
     int size_count;
-    XRRScreenSize* sizes = XRRConfigSizes(config.get(), &size_count);
+    XRRScreenSize* sizes = XRRConfigSizes(cache.config, &size_count);
 
     VideoMode vm;
     vm.xres = sizes[cur_mode_index].width;
@@ -314,15 +1172,15 @@ VideoMode GetCurrentVideoMode()
 
 void SetVideoMode(const VideoMode& m)
 {
-    Display* dpy  = GetNativeDisplayHandle();
+    connection& conn = GetDefaultConnection();
+
+    ::Display* dpy  = conn.display;
     int root = RootWindow(dpy, DefaultScreen(dpy));
 
-    auto config = MakeUniqueHandle(XRRGetScreenInfo(dpy, root), XRRFreeScreenConfigInfo);
-    if (!config)
-        throw std::runtime_error("Xrandr get config failed");
+    XRRScreenConfiguration* config = GetScreenConfig(conn);
 
     int size_count;
-    XRRScreenSize* sizes = XRRConfigSizes(config.get(), &size_count);
+    XRRScreenSize* sizes = XRRConfigSizes(config, &size_count);
 
     int found_index = -1;
     for (int i=0; i<size_count; ++i)
@@ -337,27 +1195,51 @@ void SetVideoMode(const VideoMode& m)
         throw std::runtime_error("invalid video mode");
 
     Rotation rot;
-    const int cur_mode_index = XRRConfigCurrentConfiguration(config.get(), &rot);
+    const int cur_mode_index = XRRConfigCurrentConfiguration(config, &rot);
     if (found_index == cur_mode_index)
         return;
 
-    if (XRRSetScreenConfig(dpy, config.get(), root, found_index, rot, CurrentTime) == RRSetConfigFailed)
+    if (XRRSetScreenConfig(dpy, config, root, found_index, rot, CurrentTime) == RRSetConfigFailed)
         throw std::runtime_error("Xrandr set video mode failed");
+
+    // don't wait for the notification, the new mode should be
+    // visible to the next query already.
+    ++conn.randr_generation;
 }
 
 std::vector<VideoMode> ListVideoModes()
 {
+    connection& conn = GetDefaultConnection();
+
     std::vector<VideoMode> modes;
 
-    Display* dpy  = GetNativeDisplayHandle();
-    int root = RootWindow(dpy, DefaultScreen(dpy));
+    const randr_cache& cache = GetScreenState(conn);
+    if (!cache.config)
+    {
+        if (!cache.output)
+            return modes;
+
+        const Rotation rot = cache.crtc ? cache.crtc->rotation : RR_Rotate_0;
 
-    auto config = MakeUniqueHandle(XRRGetScreenInfo(dpy, root), XRRFreeScreenConfigInfo);
-    if (!config)
-        throw std::runtime_error("Xrandrd get config failed");
+        // the modes with different refresh rates have the same size.
+        for (int i=0; i<cache.output->nmode; ++i)
+        {
+            const XRRModeInfo* mode = FindModeInfo(cache.resources, cache.output->modes[i]);
+            if (!mode)
+                continue;
+            const VideoMode vm = GetModeSize(*mode, rot);
+            const auto it = std::find_if(modes.begin(), modes.end(),
+                [&](const VideoMode& other) {
+                    return other.xres == vm.xres && other.yres == vm.yres;
+                });
+            if (it == modes.end())
+                modes.push_back(vm);
+        }
+        return modes;
+    }
 
     int size_count;
-    XRRScreenSize* sizes = XRRConfigSizes(config.get(), &size_count);
+    XRRScreenSize* sizes = XRRConfigSizes(cache.config, &size_count);
 
     for (int i=0; i<size_count; ++i)
     {
@@ -370,68 +1252,464 @@ std::vector<VideoMode> ListVideoModes()
 
 }
 
+std::vector<Monitor> ListMonitors()
+{
+    return GetMonitors(GetDefaultConnection());
+}
+
+void SetMonitorMode(const Monitor& monitor, const MonitorMode& mode)
+{
+    connection& conn = GetDefaultConnection();
+
+    randr_cache& cache = GetScreenState(conn);
+    if (!cache.resources)
+        throw std::runtime_error("XRandR 1.2 is not available");
+
+    ::Display* d = conn.display;
+    const int screen = DefaultScreen(d);
+    const ::Window root = RootWindow(d, screen);
+    XRRScreenResources* res = cache.resources;
+
+    const RROutput output_id = monitor.id;
+    const RRMode mode_id = mode.id;
+
+    auto output = MakeUniqueHandle(XRRGetOutputInfo(d, res, output_id), XRRFreeOutputInfo);
+    if (!output || output->connection != RR_Connected)
+        throw std::runtime_error("no such monitor");
+    if (!output->crtc)
+        throw std::runtime_error("monitor is turned off");
+
+    const RRMode* modes_begin = output->modes;
+    const RRMode* modes_end   = output->modes + output->nmode;
+    const XRRModeInfo* info = FindModeInfo(res, mode_id);
+    if (!info || std::find(modes_begin, modes_end, mode_id) == modes_end)
+        throw std::runtime_error("invalid video mode");
+
+    auto crtc = MakeUniqueHandle(XRRGetCrtcInfo(d, res, output->crtc), XRRFreeCrtcInfo);
+    if (!crtc)
+        throw std::runtime_error("Xrandr get crtc failed");
+    if (crtc->mode == mode_id)
+        return;
+
+    // the screen must be large enough to contain every CRTC. it's grown
+    // before the mode is set and shrunk after so that it's always valid.
+    const VideoMode size = GetModeSize(*info, crtc->rotation);
+    int width  = crtc->x + (int)size.xres;
+    int height = crtc->y + (int)size.yres;
+    for (int i=0; i<res->ncrtc; ++i)
+    {
+        if (res->crtcs[i] == output->crtc)
+            continue;
+        auto other = MakeUniqueHandle(XRRGetCrtcInfo(d, res, res->crtcs[i]), XRRFreeCrtcInfo);
+        if (!other || !other->mode)
+            continue;
+        width  = std::max(width,  other->x + (int)other->width);
+        height = std::max(height, other->y + (int)other->height);
+    }
+    const int cur_width  = DisplayWidth(d, screen);
+    const int cur_height = DisplayHeight(d, screen);
+    const int grow_width  = std::max(width,  cur_width);
+    const int grow_height = std::max(height, cur_height);
+
+    // keep the physical size so that the DPI doesn't change.
+    auto SetScreenSize = [&](int w, int h) {
+        const int mm_width  = (int)((double)w * DisplayWidthMM(d, screen)  / cur_width);
+        const int mm_height = (int)((double)h * DisplayHeightMM(d, screen) / cur_height);
+        XRRSetScreenSize(d, root, w, h, mm_width, mm_height);
+    };
+
+    // a screen size the server doesn't accept is an X error, not
+    // a status. collect the errors instead of letting Xlib exit.
+    scoped_error_range errors(d);
+
+    // nobody else should see the intermediate configuration.
+    XGrabServer(d);
+
+    if (grow_width != cur_width || grow_height != cur_height)
+        SetScreenSize(grow_width, grow_height);
+
+    const Status ret = XRRSetCrtcConfig(d, res, output->crtc, CurrentTime,
+        crtc->x, crtc->y, mode_id, crtc->rotation, crtc->outputs, crtc->noutput);
+
+    const bool success = ret == RRSetConfigSuccess;
+    if (success && (width != grow_width || height != grow_height))
+        SetScreenSize(width, height);
+    else if (!success && (grow_width != cur_width || grow_height != cur_height))
+        SetScreenSize(cur_width, cur_height);
+
+    XUngrabServer(d);
+    const int error = errors.wait();
+
+    // don't wait for the notification, the new mode should be
+    // visible to the next query already.
+    ++conn.randr_generation;
+
+    if (!success)
+        throw std::runtime_error("Xrandr set monitor mode failed");
+    if (error)
+        throw std::runtime_error("Xrandr set screen size failed");
+}
+
 bool PeekEvent(native_event_t& ev)
 {
-    Display* d = GetNativeDisplayHandle();
+    if (ReadUserEvent(ev))
+        return true;
+
+    // the input thread's events must not pass the events that are already
+    // waiting on the application's connection since those might have been
+    // sent before them (for example a focus change before a key press).
+    connection& conn = GetDefaultConnection();
+    EventRouter& router = GetEventRouter();
+    bool routed = false;
+    {
+        std::lock_guard<std::mutex> lock(router.handoff);
+        routed = router.running.load(std::memory_order_acquire);
+        if (!routed && XPending(conn.display))
+        {
+            ReadEvent(conn, ev);
+            return true;
+        }
+    }
 
-    if (!XPending(d))
-        return false;
+    // the router is the only reader of the connection once it's running.
+    if (routed)
+    {
+        XFlush(conn.display);
+        if (ReadRoutedEvent(ev))
+            return true;
+    }
+    return ReadInputEvent(ev);
+}
 
-    XEvent event = {0};
-    XNextEvent(d, &event);
+bool PeekEvent(Display& display, native_event_t& ev)
+{
+    connection& conn = GetConnection(display.GetNativeHandle());
+    if (&conn == &GetDefaultConnection())
+        return PeekEvent(ev);
 
-    // Update Xlib state when XrandR events are received.
-    XRRUpdateConfiguration(&event);
+    if (!XPending(conn.display))
+        return false;
 
-    ev = native_event_t(event);
+    ReadEvent(conn, ev);
     return true;
 }
 
 void WaitEvent(native_event_t& ev)
 {
-    Display* d = GetNativeDisplayHandle();
+    WaitEvent(ev, NO_TIMEOUT);
+}
+
+bool WaitEvent(native_event_t& ev, ms_t timeout)
+{
+    return WaitEvent(Display::GetDefault(), ev, timeout);
+}
+
+bool WaitEvent(Display& display, native_event_t& ev, ms_t timeout)
+{
+    using clock = std::chrono::steady_clock;
+
+    connection& conn = GetConnection(display.GetNativeHandle());
+
+    // the user events and the input thread only go to the default display.
+    const bool is_default = &conn == &GetDefaultConnection();
+
+    event_wakeup& wakeup = GetEventWakeup();
+
+    const auto deadline = clock::now() + std::chrono::milliseconds(timeout);
+
+    // wait on both the X connection and the wakeup for the
+    // user events, the input thread and the event router.
+    pollfd pfd[2] = {};
+    pfd[0].fd     = ConnectionNumber(conn.display);
+    pfd[0].events = POLLIN;
+    pfd[1].fd     = wakeup.fd();
+    pfd[1].events = POLLIN;
 
-    XEvent event = {0};
-    XNextEvent(d, &event);
+    for (;;)
+    {
+        if (is_default && (ReadUserEvent(ev) || ReadRoutedEvent(ev)))
+            return true;
+
+        // once the router is running only the wakeup is waited on.
+        bool routed = false;
+        {
+            std::unique_lock<std::mutex> lock;
+            if (is_default)
+            {
+                EventRouter& router = GetEventRouter();
+                lock  = std::unique_lock<std::mutex>(router.handoff);
+                routed = router.running.load(std::memory_order_acquire);
+            }
+            // XPending flushes the output buffer and reads whatever
+            // events are available on the connection without blocking.
+            if (!routed && XPending(conn.display))
+            {
+                ReadEvent(conn, ev);
+                return true;
+            }
+        }
+        // the input events only after the events waiting on the connection.
+        if (is_default && ReadInputEvent(ev))
+            return true;
+        if (routed)
+            XFlush(conn.display);
+
+        int wait = -1;
+        if (timeout != NO_TIMEOUT)
+        {
+            const auto now = clock::now();
+            if (now >= deadline)
+                return false;
+
+            // round up so that we don't spin when less than a millisecond is left.
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - now + std::chrono::microseconds(999));
+            wait = static_cast<int>(left.count());
+        }
+
+        pollfd* fds = routed ? &pfd[1] : &pfd[0];
+        const nfds_t num_fds = (is_default && !routed) ? 2 : 1;
 
-    // Update xlib state when XrandR events are received.
-    XRRUpdateConfiguration(&event);
+        if (poll(fds, num_fds, wait) == -1 && errno != EINTR)
+            throw std::runtime_error("poll failed");
 
-    ev = native_event_t(event);
+        if (pfd[1].revents & POLLIN)
+            wakeup.clear();
+    }
+    return false;
 }
 
+std::size_t PeekEvents(native_event_t* out, std::size_t max)
+{
+    std::size_t count = 0;
+    while (count < max && ReadUserEvent(out[count]))
+        ++count;
+
+    if (count == max)
+        return count;
+
+    // the events waiting on the application's connection go
+    // first, see PeekEvent about the input thread's events.
+    connection& conn = GetDefaultConnection();
+    EventRouter& router = GetEventRouter();
+    bool routed = false;
+    {
+        std::lock_guard<std::mutex> lock(router.handoff);
+        routed = router.running.load(std::memory_order_acquire);
+        // check the connection only once. If the queue is empty this will try to
+        // read more events from the connection but after that we simply drain
+        // the events that are already in Xlib's queue.
+        if (!routed && XEventsQueued(conn.display, QueuedAfterReading))
+        {
+            while (count < max && XEventsQueued(conn.display, QueuedAlready))
+                ReadEvent(conn, out[count++]);
+        }
+    }
 
-std::pair<bitflag<Keymod>, Keysym> TranslateKeydownEvent(const native_event_t& key)
+    if (routed)
+    {
+        XFlush(conn.display);
+        while (count < max && ReadRoutedEvent(out[count]))
+            ++count;
+    }
+    while (count < max && ReadInputEvent(out[count]))
+        ++count;
+    return count;
+}
+
+std::size_t WaitEvents(native_event_t* out, std::size_t max)
 {
-    std::pair<bitflag<Keymod>, Keysym> ret = {{}, Keysym::None};
+    assert(max);
 
-    const XEvent& ev = key;
+    // block for the first event.
+    WaitEvent(out[0]);
 
-    XKeyEvent xev = ev.xkey;
+    // then take whatever else is available.
+    return 1 + PeekEvents(out + 1, max - 1);
+}
 
-    // disregard modifiers for symbol lookup, only want to look up the keysym,
-    // not X's idea of translated keysym+modifier
-    xev.state = 0;
+bool PostUserEvent(std::uintptr_t payload)
+{
+    if (!GetUserEventQueue().push(payload))
+        return false;
 
-    KeySym sym = NoSymbol;
-    XLookupString(&xev, NULL, 0, &sym, NULL);
-    if (sym == NoSymbol)
-        return ret;
+    GetEventWakeup().signal();
+    return true;
+}
+
+std::uintptr_t GetUserEventPayload(const native_event_t& ev)
+{
+    assert(ev.identity() == native_event_t::type::user);
+
+    const XEvent& event = ev;
+    return static_cast<std::uintptr_t>(event.xclient.data.l[0]);
+}
+
+void StartInputThread()
+{
+    // the input thread uses the wakeup so it must outlive the thread.
+    GetEventWakeup();
+
+    InputThread& input = GetInputThread();
+    if (input.running)
+        return;
+
+    // opening the default display enables the Xlib thread support.
+    input.app_display = GetNativeDisplayHandle();
+    input.display     = XOpenDisplay(DisplayString(input.app_display));
+    if (!input.display)
+        throw std::runtime_error("cannot open X display for input thread");
+
+    // the input thread blocks in XNextEvent on its own connection and
+    // this window is only used to wake it up when the thread is stopped.
+    input.wakeup_window = XCreateWindow(input.display,
+        RootWindow(input.display, DefaultScreen(input.display)),
+        0, 0, 1, 1, 0, 0, InputOnly, CopyFromParent, 0, nullptr);
+    XFlush(input.display);
+
+    input.stop    = false;
+    input.thread  = std::thread(InputThreadMain, &input);
+    input.running.store(true, std::memory_order_release);
+}
+
+bool IsInputThreadRunning()
+{
+    return GetInputThread().running.load(std::memory_order_acquire);
+}
+
+void SelectInputThreadEvents(::Window window)
+{
+    InputThread& input = GetInputThread();
+    assert(input.running);
+
+    XSelectInput(input.display, window, InputEventMask);
+    XFlush(input.display);
+}
+
+bool IsEventRouterRunning()
+{
+    return GetEventRouter().running.load(std::memory_order_acquire);
+}
+
+void SetWindowThreadAffinity(native_window_t window)
+{
+    assert(window);
+
+    {
+        WindowAffinity& affinity = GetWindowAffinity();
+        std::lock_guard<std::mutex> lock(affinity.mutex);
+        affinity.windows[window] = GetThreadEventQueue();
+    }
+
+    EventRouter& router = GetEventRouter();
+    std::call_once(router.start, StartEventRouter, std::ref(router));
+}
+
+void ClearWindowThreadAffinity(native_window_t window)
+{
+    WindowAffinity& affinity = GetWindowAffinity();
+    std::lock_guard<std::mutex> lock(affinity.mutex);
+    affinity.windows.erase(window);
+}
+
+bool PeekThreadEvent(native_event_t& ev)
+{
+    // the router only reads, the requests are flushed by the threads.
+    XFlush(GetNativeDisplayHandle());
+
+    return GetThreadEventQueue()->queue.pop(ev);
+}
+
+bool WaitThreadEvent(native_event_t& ev, ms_t timeout)
+{
+    using clock = std::chrono::steady_clock;
+
+    ThreadEventQueue& thread = *GetThreadEventQueue();
+
+    const auto deadline = clock::now() + std::chrono::milliseconds(timeout);
 
-    // have to do a linear search since the keyboard mapping table
-    // is sorted by X11 values.
-    const auto it = std::find_if(std::begin(keymap), std::end(keymap),
-        [=] (const key_mapping& map)
+    pollfd pfd = {};
+    pfd.fd     = thread.wakeup.fd();
+    pfd.events = POLLIN;
+
+    for (;;)
+    {
+        XFlush(GetNativeDisplayHandle());
+
+        if (thread.queue.pop(ev))
+            return true;
+
+        int wait = -1;
+        if (timeout != NO_TIMEOUT)
         {
-            return map.x11 == sym;
-        });
-    if (it == std::end(keymap))
+            const auto now = clock::now();
+            if (now >= deadline)
+                return false;
+
+            // round up so that we don't spin when less than a millisecond is left.
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - now + std::chrono::microseconds(999));
+            wait = static_cast<int>(left.count());
+        }
+
+        if (poll(&pfd, 1, wait) == -1 && errno != EINTR)
+            throw std::runtime_error("poll failed");
+
+        if (pfd.revents & POLLIN)
+            thread.wakeup.clear();
+    }
+    return false;
+}
+
+void BeginResourceBatch()
+{
+    BeginResourceBatch(Display::GetDefault());
+}
+
+void EndResourceBatch()
+{
+    EndResourceBatch(Display::GetDefault());
+}
+
+void BeginResourceBatch(Display& display)
+{
+    error_tracker::get().begin_batch(display.GetNativeHandle());
+}
+
+void EndResourceBatch(Display& display)
+{
+    if (error_tracker::get().end_batch(display.GetNativeHandle()))
+        throw std::runtime_error("resource creation failed");
+}
+
+void SetMouseMoveCoalescing(bool on)
+{
+    CoalesceMouseMove = on;
+}
+
+std::pair<bitflag<Keymod>, Keysym> TranslateKeydownEvent(const native_event_t& key)
+{
+    return TranslateKeydownEvent(GetConnection(key.get().xkey.display), key);
+}
+
+std::pair<bitflag<Keymod>, Keysym> TranslateKeydownEvent(connection& conn, const native_event_t& key)
+{
+    std::pair<bitflag<Keymod>, Keysym> ret = {{}, Keysym::None};
+
+    const XEvent& ev = key;
+
+    const keyboard_tables& tables = InitKeyboard(conn);
+
+    // the table has the symbol for the key without modifiers, we only
+    // want the keysym, not X's idea of translated keysym+modifier
+    const keycode_mapping& map = tables.keycodes[ev.xkey.keycode & 0xff];
+    if (map.wdk == Keysym::None)
         return ret;
 
     const uint native_modifier = ev.xkey.state;
 
-    ret.second = (*it).wdk;
-    if (native_modifier & AltMask)
+    ret.second = map.wdk;
+    if (native_modifier & tables.alt_mask)
         ret.first |= Keymod::Alt;
     if (native_modifier & ControlMask)
         ret.first |= Keymod::Control;
@@ -441,7 +1719,45 @@ std::pair<bitflag<Keymod>, Keysym> TranslateKeydownEvent(const native_event_t& k
     return ret;
 }
 
+long TranslateCharacter(const XKeyEvent& key)
+{
+    return TranslateCharacter(GetConnection(key.display), key);
+}
+
+long TranslateCharacter(connection& conn, const XKeyEvent& key)
+{
+    const keyboard_tables& tables = InitKeyboard(conn);
+
+    const keycode_mapping& map = tables.keycodes[key.keycode & 0xff];
+
+    // control and alt don't change the symbol and neither does
+    // num lock unless the key is on the keypad.
+    unsigned state = key.state & ~(ControlMask | tables.alt_mask |
+        Button1Mask | Button2Mask | Button3Mask | Button4Mask | Button5Mask);
+    if (!map.keypad)
+        state &= ~tables.numlock_mask;
+
+    if (state == 0)
+        return map.ucs[0];
+    else if (state == ShiftMask)
+        return map.ucs[1];
+
+    // leave the rest such as caps lock, AltGr and
+    // group switching to Xlib.
+    KeySym sym = NoSymbol;
+    XLookupString(const_cast<XKeyEvent*>(&key), nullptr, 0, &sym, nullptr);
+    if (sym == NoSymbol)
+        return -1;
+
+    return linux::keysym2ucs(sym);
+}
+
 std::pair<bitflag<Keymod>, MouseButton> TranslateMouseButtonEvent(const native_event_t& btn)
+{
+    return TranslateMouseButtonEvent(GetConnection(btn.get().xbutton.display), btn);
+}
+
+std::pair<bitflag<Keymod>, MouseButton> TranslateMouseButtonEvent(connection& conn, const native_event_t& btn)
 {
     MouseButton b = MouseButton::None;
     bitflag<Keymod> m { Keymod::None };
@@ -470,7 +1786,10 @@ std::pair<bitflag<Keymod>, MouseButton> TranslateMouseButtonEvent(const native_e
     // todo: thumb1 and thumb2 buttons
     const auto state  = btn.get().xbutton.state;
 
-    if (state & AltMask)
+    // needed for the alt mask.
+    const keyboard_tables& tables = InitKeyboard(conn);
+
+    if (state & tables.alt_mask)
         m.set(Keymod::Alt);
     if (state & ControlMask)
         m.set(Keymod::Control);
@@ -480,6 +1799,13 @@ std::pair<bitflag<Keymod>, MouseButton> TranslateMouseButtonEvent(const native_e
     return { m, b };
 }
 
+InputSnapshot GetInputSnapshot()
+{
+    InputState& input = GetInputState();
+    std::lock_guard<std::mutex> lock(input.mutex);
+    return input.snapshot;
+}
+
 bool TestKeyDown(Keysym symbol)
 {
     const KeySym sym = find_keysym(symbol);
@@ -492,7 +1818,7 @@ bool TestKeyDown(uint_t keycode)
 {
     assert(keycode);
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = GetNativeDisplayHandle();
 
     uint8_t key_states[32];
     XQueryKeymap(d, (char*)key_states);
@@ -502,7 +1828,7 @@ bool TestKeyDown(uint_t keycode)
 
 uint_t MapKeysymToNativeKeycode(Keysym symbol)
 {
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = GetNativeDisplayHandle();
 
     const KeySym sym = find_keysym(symbol);
     const KeyCode code = XKeysymToKeycode(d, sym);
@@ -23,8 +23,11 @@
 
 #include <X11/Xlib.h>
 #include <X11/extensions/Xrandr.h>
+#include <cstring>
+#include <new>
 #include "wdk/X11/atoms.h"
 #include "wdk/X11/types.h"
+#include "wdk/X11/eventqueue.h"
 
 namespace wdk
 {
@@ -34,40 +37,64 @@ static_assert(sizeof(detail::Window) == sizeof(Window),
 static_assert(sizeof(detail::Pixmap) == sizeof(Pixmap),
     "X11 pixmap type is not unsigned long");
 
-native_event_t::native_event_t() : event_(std::make_shared<XEvent>())
-{}
+native_event_t::native_event_t()
+{
+    static_assert(sizeof(event_) == sizeof(XEvent),
+        "native event storage doesn't match the size of XEvent");
+    static_assert(alignof(XEvent) <= alignof(long),
+        "native event storage doesn't match the alignment of XEvent");
+
+    std::memset(event_, 0, sizeof(event_));
+}
+
+native_event_t::native_event_t(const XEvent& e, unsigned samples)
+    : samples_(samples)
+    , timestamp_(std::chrono::steady_clock::now())
+{
+    new (event_) XEvent(e);
+}
 
-native_event_t::native_event_t(const XEvent& e) : event_(std::make_shared<XEvent>(e))
-{}
+native_event_t::native_event_t(const XEvent& e, unsigned samples,
+    std::chrono::steady_clock::time_point timestamp)
+    : samples_(samples)
+    , timestamp_(timestamp)
+{
+    new (event_) XEvent(e);
+}
 
 native_event_t::operator const XEvent& () const
 {
-    return *event_;
+    return get();
 }
 
 native_window_t native_event_t::get_window_handle() const
 {
-    if  (event_->type == KeymapNotify)
+    const XEvent& event = get();
+
+    if  (event.type == KeymapNotify)
         return native_window_t { 0 };
-    else if (event_->type == CreateNotify)
-        return native_window_t { event_->xcreatewindow.window };
-    else if (event_->type == MapNotify)
-        return native_window_t { event_->xmap.window };
+    else if (event.type == CreateNotify)
+        return native_window_t { event.xcreatewindow.window };
+    else if (event.type == MapNotify)
+        return native_window_t { event.xmap.window };
 
-    return native_window_t  {event_->xany.window};
+    return native_window_t  {event.xany.window};
 }
 
 const XEvent& native_event_t::get() const
 {
-    return *event_;
+    return *reinterpret_cast<const XEvent*>(event_);
 }
 
 native_event_t::type native_event_t::identity() const
 {
-    if ((event_->type - XRandREventBase) == RRScreenChangeNotify)
+    const XEvent& event = get();
+
+    // the event base is only known once XRandR has been initialized.
+    if (XRandREventBase && (event.type - XRandREventBase) == RRScreenChangeNotify)
         return type::system_resolution_change;
 
-    switch (event_->type)
+    switch (event.type)
     {
         case FocusIn:         return type::window_gain_focus;
         case FocusOut:        return type::window_lost_focus;
@@ -79,9 +106,8 @@ native_event_t::type native_event_t::identity() const
         case MotionNotify:    return type::window_mouse_move;
         case ButtonPress:     return type::window_mouse_press;
         case ButtonRelease:   return type::window_mouse_release;
-        case MapNotify:
-            if (event_->xany.send_event)
-                return type::window_char;
+        case UserEvent:       return type::user;
+        case RawMotionEvent:  return type::window_raw_mouse_move;
 
         default:
             break;
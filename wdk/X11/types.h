@@ -28,7 +28,7 @@
 //#include <X11/Xlib.h>
 //#include <X11/extensions/Xrandr.h>
 
-#include <memory>
+#include <chrono>
 
 struct _XDisplay;
 union  _XEvent;
@@ -83,17 +83,25 @@ namespace wdk
             window_destroy,
             window_keydown,
             window_keyup,
+            // Win32 only. On X11 the character is decoded from the key
+            // press event so identity() never returns this. It's kept so
+            // that code switching on the identities builds on both.
             window_char,
             window_mouse_move,
             window_mouse_press,
             window_mouse_release,
+            window_raw_mouse_move,
 
             system_resolution_change,
+            user,
             other
         };
 
         native_event_t();
-        native_event_t(const _XEvent& e);
+        native_event_t(const _XEvent& e, unsigned samples = 1);
+        // create an event with the given timestamp instead of the current time.
+        native_event_t(const _XEvent& e, unsigned samples,
+            std::chrono::steady_clock::time_point timestamp);
 
         operator const _XEvent& () const;
 
@@ -103,9 +111,28 @@ namespace wdk
 
         type identity() const;
 
+        // get the number of raw events that this event represents.
+        // this is more than 1 when consecutive events have been coalesced.
+        unsigned get_sample_count() const
+        { return samples_; }
+
+        // get the time (on the steady/monotonic clock) when the
+        // event was read from the display connection.
+        std::chrono::steady_clock::time_point get_timestamp() const
+        { return timestamp_; }
+
     private:
-        std::shared_ptr<_XEvent> event_;
+        // The event is stored inline in order to avoid doing a dynamic
+        // allocation for every event that is read from the display.
+        // Since we don't want to include the X headers here the storage
+        // is just a raw buffer with the size and alignment of XEvent
+        // (which is a union padded to 24 longs). Copying an event is
+        // thus a simple memcpy.
+        alignas(long) unsigned char event_[24 * sizeof(long)];
+
+        unsigned samples_ = 1;
 
+        std::chrono::steady_clock::time_point timestamp_;
     };
 
     const native_window_t  NULL_WINDOW  {0};
@@ -22,41 +22,299 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/extensions/XInput2.h>
+
+#include <poll.h>
 
 #include <stdexcept>
+#include <chrono>
+#include <cerrno>
+#include <algorithm>
 #include <limits>
 #include <cassert>
 #include <cstring>
+#include <cstdlib>
 
 #include "wdk/events.h"
 #include "wdk/window.h"
+#include "wdk/dispatcher.h"
 #include "wdk/system.h"
 #include "wdk/videomode.h"
 #include "wdk/utf8.h"
 #include "wdk/X11/errorhandler.h"
 #include "wdk/X11/atoms.h"
+#include "wdk/X11/connection.h"
+#include "wdk/X11/eventqueue.h"
+#include "wdk/X11/keyboard.h"
 
 #define X11_None 0L
 #define X11_RevertToNone 0
 
-// g++ -std=gnu++14 defines linux (doh)
-#undef linux
+namespace {
+
+// Client side copy of the window geometry. Kept up to date from the
+// ConfigureNotify, ReparentNotify and PropertyNotify events so that
+// the getters don't need to make round trips to the server.
+struct geometry_cache {
+    // origin of the window's client area in root window coordinates.
+    int x = 0;
+    int y = 0;
+    int width  = 0;
+    int height = 0;
+    // left and top frame extents (_NET_FRAME_EXTENTS) set by the
+    // window manager for the decorations if any.
+    long frame_left = 0;
+    long frame_top  = 0;
+    bool origin_valid = false;
+    bool frame_valid  = false;
+    // false after the size has been changed with SetSize or
+    // SetFullscreen until it's queried again.
+    bool size_valid   = true;
+    // true when the window manager has reparented the window into a frame.
+    bool reparented = false;
+};
+
+// Query the size if it has been changed since it was last known.
+void RefreshSize(const wdk::connection& conn, ::Window window, geometry_cache& geom)
+{
+    if (geom.size_valid)
+        return;
+
+    ::Window root_dummy = X11_None;
+    int x = 0;
+    int y = 0;
+    unsigned width  = 0;
+    unsigned height = 0;
+    unsigned border = 0;
+    unsigned depth  = 0;
+    if (::XGetGeometry(conn.display, window, &root_dummy, &x, &y, &width, &height, &border, &depth))
+    {
+        geom.width  = width;
+        geom.height = height;
+        geom.size_valid = true;
+    }
+}
+
+// Query the parts of the cached geometry that are not currently known.
+// A part whose query fails stays invalid and is queried again next time.
+void RefreshGeometry(const wdk::connection& conn, ::Window window, geometry_cache& geom)
+{
+    RefreshSize(conn, window, geom);
+
+    if (geom.origin_valid && geom.frame_valid)
+        return;
+
+    ::Display* d = conn.display;
+
+    const ::Window root_window = RootWindow(d, DefaultScreen(d));
+
+    if (!geom.origin_valid)
+    {
+        // Translate the position 0,0 in our window to root window coordinate space.
+        ::Window child_dummy = X11_None;
+        int x = 0;
+        int y = 0;
+        if (::XTranslateCoordinates(d, window, root_window, 0, 0, &x, &y, &child_dummy))
+        {
+            geom.x = x;
+            geom.y = y;
+            geom.origin_valid = true;
+        }
+    }
+    if (!geom.frame_valid)
+    {
+        geom.frame_left = 0;
+        geom.frame_top  = 0;
+
+        Atom actual_type;
+        int actual_format = 0;
+        unsigned long nitems, bytes_after;
+        unsigned char *data = nullptr;
+        if (::XGetWindowProperty(d, window, conn.atoms._NET_FRAME_EXTENTS,
+            0, 4, False, AnyPropertyType,
+            &actual_type, &actual_format,
+            &nitems, &bytes_after, &data) == Success)
+        {
+            // no property means no decorations.
+            // the property is a list of 32 bit values which Xlib returns as longs.
+            if (data && nitems == 4 && actual_format == 32)
+            {
+                const auto* borders = (const long*)data;
+                geom.frame_left = borders[0];
+                geom.frame_top  = borders[2];
+            }
+            if (data)
+                ::XFree(data);
+            geom.frame_valid = true;
+        }
+    }
+}
+
+// Wait until the window gets exposed for the first time, i.e. it has
+// been mapped and is visible. The Expose event is left in the queue.
+// Returns false if the timeout expires first.
+bool WaitExpose(::Display* d, ::Window window, wdk::ms_t timeout)
+{
+    using clock = std::chrono::steady_clock;
+
+    const auto deadline = clock::now() + std::chrono::milliseconds(timeout);
+
+    pollfd pfd = {};
+    pfd.fd     = ConnectionNumber(d);
+    pfd.events = POLLIN;
+
+    for (;;)
+    {
+        // flushes the output buffer and reads whatever
+        // events are available without blocking.
+        XEvent ev;
+        if (XCheckTypedWindowEvent(d, window, Expose, &ev))
+        {
+            XPutBackEvent(d, &ev);
+            return true;
+        }
+
+        int wait = -1;
+        if (timeout != wdk::NO_TIMEOUT)
+        {
+            const auto now = clock::now();
+            if (now >= deadline)
+                return false;
+
+            // round up so that we don't spin when less than a millisecond is left.
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - now + std::chrono::microseconds(999));
+            wait = static_cast<int>(left.count());
+        }
+
+        if (poll(&pfd, 1, wait) == -1 && errno != EINTR)
+            throw std::runtime_error("poll failed");
+    }
+    return false;
+}
+
+// add a rectangle to the accumulated damage region.
+void AddDamage(wdk::WindowEventPaint& damage, int x, int y, int width, int height)
+{
+    using Rect = wdk::WindowEventPaint::Rect;
+
+    const int right  = x + width;
+    const int bottom = y + height;
+
+    if (damage.num_rects == 0)
+    {
+        damage.x = x;
+        damage.y = y;
+        damage.width  = width;
+        damage.height = height;
+    }
+    else
+    {
+        const int left = std::min(damage.x, x);
+        const int top  = std::min(damage.y, y);
+        damage.width  = std::max(damage.x + damage.width, right) - left;
+        damage.height = std::max(damage.y + damage.height, bottom) - top;
+        damage.x = left;
+        damage.y = top;
+    }
+
+    if (damage.num_rects < wdk::WindowEventPaint::MaxRects)
+    {
+        Rect& rc = damage.rects[damage.num_rects++];
+        rc.x = x;
+        rc.y = y;
+        rc.width  = width;
+        rc.height = height;
+        return;
+    }
+    // out of space, merge into the last rectangle.
+    Rect& rc = damage.rects[damage.num_rects - 1];
+    const int left = std::min(rc.x, x);
+    const int top  = std::min(rc.y, y);
+    rc.width  = std::max(rc.x + rc.width, right) - left;
+    rc.height = std::max(rc.y + rc.height, bottom) - top;
+    rc.x = left;
+    rc.y = top;
+}
+
+// initialize the XInput2 extension for raw input.
+// returns false if the extension is not available.
+bool InitXInput2(::Display* d)
+{
+    if (wdk::XInputOpcode)
+        return true;
+
+    int opcode = 0;
+    int event  = 0;
+    int error  = 0;
+    if (!XQueryExtension(d, "XInputExtension", &opcode, &event, &error))
+        return false;
+
+    int major = 2;
+    int minor = 0;
+    if (XIQueryVersion(d, &major, &minor) != Success)
+        return false;
+
+    wdk::XInputOpcode = opcode;
+    return true;
+}
+
+// select or deselect the raw motion events for all the pointer devices.
+// raw events are only ever delivered to the root window.
+void SelectRawMotion(::Display* d, bool on)
+{
+    unsigned char mask[XIMaskLen(XI_RawMotion)] = {0};
+    if (on)
+        XISetMask(mask, XI_RawMotion);
+
+    XIEventMask event_mask;
+    event_mask.deviceid = XIAllMasterDevices;
+    event_mask.mask_len = sizeof(mask);
+    event_mask.mask     = mask;
+    XISelectEvents(d, DefaultRootWindow(d), &event_mask, 1);
+}
+
+Cursor CreateInvisibleCursor(::Display* d, ::Window window)
+{
+    static char null[] = { 0,0,0,0};
+    XColor black  = {0};
+    Pixmap pixmap = XCreateBitmapFromData(d, window, null, 1, 1);
+    Cursor cursor = XCreatePixmapCursor(d, pixmap, pixmap, &black, &black, 0, 0);
+    XFreePixmap(d, pixmap);
+    return cursor;
+}
 
-namespace linux {
-    long keysym2ucs(KeySym keysym);
-}// linux
+} // namespace
 
 namespace wdk
 {
 
 struct Window::impl {
+    // the display the window is created on, nullptr for the default.
+    Display* display = nullptr;
+    // the display's connection once the window has been created.
+    connection* conn = nullptr;
     ::Window window = 0;
+    // the last size reported in a resize event.
     int width = 0;
     int height = 0;
+    geometry_cache geometry;
     Encoding enc;
     bool fullscreen = false;
     bool cursor     = true;
     bool mouse_grab = false;
+    bool coalesce_resize = false;
+    // how long Create waits for the window to become visible.
+    ms_t create_timeout = NO_TIMEOUT;
+    // damage accumulated from expose events and calls to
+    // Invalidate that hasn't been delivered in a paint event yet.
+    WindowEventPaint damage;
+    // true when a repaint has been scheduled by Invalidate.
+    bool paint_pending = false;
+    bool relative_mouse = false;
+    // cursors are created on first use.
+    Cursor invisible_cursor = 0;
+    Cursor grab_cursor = 0;
 };
 
 Window::Window() : pimpl_(new impl)
@@ -65,6 +323,11 @@ Window::Window() : pimpl_(new impl)
     pimpl_->enc    = Encoding::UTF8;
 }
 
+Window::Window(Display& display) : Window()
+{
+    pimpl_->display = &display;
+}
+
 Window::~Window()
 {
     if (DoesExist())
@@ -79,7 +342,11 @@ void Window::Create(const std::string& title, uint_t width, uint_t height, uint_
     assert(!title.empty());
     assert(!pimpl_->window);
 
-    Display* d = GetNativeDisplayHandle();
+    Display& display = pimpl_->display ? *pimpl_->display : Display::GetDefault();
+    connection& conn = GetConnection(display.GetNativeHandle());
+    pimpl_->conn = &conn;
+
+    ::Display* d = conn.display;
 
     int screen = DefaultScreen(d);
     int root   = RootWindow(d, screen);
@@ -102,13 +369,23 @@ void Window::Create(const std::string& title, uint_t width, uint_t height, uint_
                                 PointerMotionMask | ButtonMotionMask | // pointer aka.mouse motion
                                 StructureNotifyMask | // window size changed, mapping change (ConfigureNotify)
                                 ExposureMask | // window exposure (paint)
-                                FocusChangeMask; // lost, gain focus
+                                FocusChangeMask | // lost, gain focus
+                                PropertyChangeMask | // window manager frame extents
+                                KeymapStateMask; // keyboard state after gaining focus
+
+    // the event dispatcher and the input thread only handle the default display.
+    const bool is_default = &conn == &GetDefaultConnection();
+
+    // when the input thread is running it reads the input events on its own connection.
+    const bool input_thread = is_default && IsInputThreadRunning();
+    if (input_thread)
+        attr.event_mask &= ~InputEventMask;
 
     const unsigned long AttrMask = CWBackPixel | CWBorderPixel | CWColormap | CWEventMask;
 
     factory<::Window> win_factory(d);
 
-    ::Window win = win_factory.create([&](Display* d)
+    ::Window win = win_factory.create([&](::Display* d)
     {
         ::Window ret = XCreateWindow(d,
             root,
@@ -131,7 +408,10 @@ void Window::Create(const std::string& title, uint_t width, uint_t height, uint_
     if (win_factory.has_error())
         throw std::runtime_error("failed to create window");
 
-    XSetWMProtocols(d, win, &WM_DELETE_WINDOW, 1);
+    if (input_thread)
+        SelectInputThreadEvents(win);
+
+    XSetWMProtocols(d, win, &conn.atoms.WM_DELETE_WINDOW, 1);
     XStoreName(d, win, title.c_str());
 
     if (!has_border)
@@ -148,7 +428,7 @@ void Window::Create(const std::string& title, uint_t width, uint_t height, uint_
         hint hints = {0};
         hints.flags = 2;         // window decorations flag
         hints.decorations = 0;   // ...say bye bye
-        XChangeProperty(d, win, _MOTIF_WM_HINTS, _MOTIF_WM_HINTS, 32, PropModeReplace, static_cast<unsigned char*>((void*)&hints), 5);
+        XChangeProperty(d, win, conn.atoms._MOTIF_WM_HINTS, conn.atoms._MOTIF_WM_HINTS, 32, PropModeReplace, static_cast<unsigned char*>((void*)&hints), 5);
     }
 
     if (!can_resize)
@@ -159,7 +439,7 @@ void Window::Create(const std::string& title, uint_t width, uint_t height, uint_
         hints->min_width  = hints->max_width  = width;
         hints->min_height = hints->max_height = height;
 
-        XSetWMSizeHints(d, win, hints, WM_SIZE_HINTS);
+        XSetWMSizeHints(d, win, hints, conn.atoms.WM_SIZE_HINTS);
         XSetWMNormalHints(d, win, hints);
         XFree(hints);
     }
@@ -173,11 +453,10 @@ void Window::Create(const std::string& title, uint_t width, uint_t height, uint_
         // the client code can call a function such as set_setfocus which
         // fails siply because the WM hasn't mapped the window yet.
         // so we wait here  untill we're notified that it's actually mapped.
-        XEvent ev;
-        while (XCheckTypedWindowEvent(d, win, Expose, &ev) == False)
-            (void)0;
-
-        XPutBackEvent(d, &ev);
+        // when the event router is running it's the only reader of the
+        // connection and the expose goes through it instead.
+        if (pimpl_->create_timeout && !(is_default && IsEventRouterRunning()))
+            WaitExpose(d, win, pimpl_->create_timeout);
     }
 
     XFlush(d);
@@ -185,14 +464,20 @@ void Window::Create(const std::string& title, uint_t width, uint_t height, uint_
     pimpl_->window   = win;
     pimpl_->width    = 0;
     pimpl_->height   = 0;
+    pimpl_->geometry = geometry_cache{};
+    pimpl_->geometry.width  = width;
+    pimpl_->geometry.height = height;
     pimpl_->fullscreen = false;
+
+    if (is_default)
+        EventDispatcher::AddWindow(GetNativeHandle(), this);
 }
 
 void Window::Hide()
 {
     assert(DoesExist());
 
-    Display* display = GetNativeDisplayHandle();
+    ::Display* display = pimpl_->conn->display;
 
     XUnmapWindow(display, pimpl_->window);
 }
@@ -201,7 +486,7 @@ void Window::Show()
 {
     assert(DoesExist());
 
-    Display* display = GetNativeDisplayHandle();
+    ::Display* display = pimpl_->conn->display;
 
     XMapWindow(display, pimpl_->window);
 }
@@ -210,7 +495,7 @@ void Window::Destroy()
 {
     assert(DoesExist());
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->conn->display;
 
     if (pimpl_->fullscreen)
     {
@@ -218,26 +503,71 @@ void Window::Destroy()
         XUngrabKeyboard(d, CurrentTime);
     }
 
+    if (pimpl_->relative_mouse)
+        SetRelativeMouseMode(false);
+
+    if (pimpl_->conn == &GetDefaultConnection())
+    {
+        EventDispatcher::RemoveWindow(GetNativeHandle());
+        ClearWindowThreadAffinity(GetNativeHandle());
+    }
+
+    if (pimpl_->invisible_cursor)
+        XFreeCursor(d, pimpl_->invisible_cursor);
+    if (pimpl_->grab_cursor)
+        XFreeCursor(d, pimpl_->grab_cursor);
+    pimpl_->invisible_cursor = 0;
+    pimpl_->grab_cursor = 0;
+
     XUnmapWindow(d, pimpl_->window);
     XDestroyWindow(d, pimpl_->window);
     XFlush(d);
 
     pimpl_->window = 0;
-
+    pimpl_->damage = WindowEventPaint{};
+    pimpl_->paint_pending = false;
 }
 
 void Window::Invalidate()
 {
     assert(DoesExist());
 
-    Display* d = GetNativeDisplayHandle();
+    Invalidate(0, 0, pimpl_->geometry.width, pimpl_->geometry.height);
+}
 
-    XClearArea(d, pimpl_->window,
-        0, 0,
-        GetSurfaceWidth(),
-        GetSurfaceHeight(),
-        True);
-    XFlush(d);
+void Window::Invalidate(int x, int y, int width, int height)
+{
+    assert(DoesExist());
+
+    if (width <= 0 || height <= 0)
+        return;
+
+    AddDamage(pimpl_->damage, x, y, width, height);
+    if (pimpl_->paint_pending)
+        return;
+
+    // set before the event is posted, the event can be processed
+    // (and the flag cleared) before the post returns.
+    pimpl_->paint_pending = true;
+
+    // schedule a repaint by putting an empty expose event in the
+    // event queue. This doesn't involve the server at all and the
+    // damage is then delivered when the event is processed.
+    XEvent ev = {0};
+    ev.xexpose.type       = Expose;
+    ev.xexpose.send_event = True;
+    ev.xexpose.display    = pimpl_->conn->display;
+    ev.xexpose.window     = pimpl_->window;
+    ev.xexpose.count      = 0;
+
+    // the event router is blocked reading the connection and wouldn't
+    // see an event put back in the queue, so go through the server then.
+    if (pimpl_->conn == &GetDefaultConnection() && IsEventRouterRunning())
+    {
+        XSendEvent(ev.xexpose.display, pimpl_->window, False, ExposureMask, &ev);
+        XFlush(ev.xexpose.display);
+    }
+    else XPutBackEvent(ev.xexpose.display, &ev);
 }
 
 void Window::Move(int x, int y)
@@ -245,7 +575,7 @@ void Window::Move(int x, int y)
     assert(DoesExist());
     assert(!IsFullscreen());
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->conn->display;
 
     XMoveWindow(d, pimpl_->window, x, y);
     XFlush(d);
@@ -258,8 +588,9 @@ void Window::SetFullscreen(bool fullscreen)
     if (fullscreen == pimpl_->fullscreen)
         return;
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->conn->display;
     ::Window   w = GetNativeHandle();
+    const display_atoms& atoms = pimpl_->conn->atoms;
 
     // todo: this is a bit slow at changing and will get confused if
     // multiple requests are made before the previous one is complete
@@ -268,11 +599,11 @@ void Window::SetFullscreen(bool fullscreen)
         XEvent ev;
         std::memset(&ev, 0, sizeof(ev));
         ev.type = ClientMessage;
-        ev.xclient.message_type = _NET_WM_STATE;
+        ev.xclient.message_type = atoms._NET_WM_STATE;
         ev.xclient.format       = 32;
         ev.xclient.window       = w;
         ev.xclient.data.l[0]    = _NET_WM_STATE_ADD;
-        ev.xclient.data.l[1]    = _NET_WM_STATE_FULLSCREEN;
+        ev.xclient.data.l[1]    = atoms._NET_WM_STATE_FULLSCREEN;
         ev.xclient.data.l[3]    = w;
         XSendEvent(d, DefaultRootWindow(d), False, SubstructureRedirectMask | SubstructureNotifyMask, &ev);
 
@@ -292,11 +623,11 @@ void Window::SetFullscreen(bool fullscreen)
         XEvent ev;
         std::memset(&ev, 0, sizeof(ev));
         ev.type = ClientMessage;
-        ev.xclient.message_type = _NET_WM_STATE;
+        ev.xclient.message_type = atoms._NET_WM_STATE;
         ev.xclient.format       = 32;
         ev.xclient.window       = w;
         ev.xclient.data.l[0]    = _NET_WM_STATE_REMOVE;
-        ev.xclient.data.l[1]    = _NET_WM_STATE_FULLSCREEN;
+        ev.xclient.data.l[1]    = atoms._NET_WM_STATE_FULLSCREEN;
         ev.xclient.data.l[3]    = w;
         XSendEvent(d, DefaultRootWindow(d), False, SubstructureRedirectMask | SubstructureNotifyMask, &ev);
 
@@ -304,27 +635,23 @@ void Window::SetFullscreen(bool fullscreen)
     XFlush(d);
 
     pimpl_->fullscreen = fullscreen;
+    pimpl_->geometry.size_valid   = false;
+    pimpl_->geometry.origin_valid = false;
 }
 
 void Window::ShowCursor(bool on)
 {
     assert(DoesExist());
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->conn->display;
     if (on)
     {
-        XUndefineCursor(GetNativeDisplayHandle(), pimpl_->window);
+        XUndefineCursor(d, pimpl_->window);
     }
     else
     {
-        static char null[] = { 0,0,0,0};
-        Cursor invisibleCursor;
-        Pixmap bitmapNoData;
-        XColor black  = {0};
-        Pixmap pixmap = XCreateBitmapFromData(d, pimpl_->window, null, 1, 1);
-        Cursor cursor = XCreatePixmapCursor(d, pixmap, pixmap, &black, &black, 0, 0);
-        XDefineCursor(d, pimpl_->window, cursor);
-        XFreeCursor(d, cursor);
-        XFreePixmap(d, pixmap);
+        if (!pimpl_->invisible_cursor)
+            pimpl_->invisible_cursor = CreateInvisibleCursor(d, pimpl_->window);
+        XDefineCursor(d, pimpl_->window, pimpl_->invisible_cursor);
     }
     pimpl_->cursor = on;
     XFlush(d);
@@ -332,7 +659,7 @@ void Window::ShowCursor(bool on)
 
 bool Window::GrabMouse(bool on_off)
 {
-    auto* display = GetNativeDisplayHandle();
+    auto* display = pimpl_->conn->display;
     if (on_off)
     {
         const auto event_mask = ButtonPressMask | ButtonReleaseMask |
@@ -340,25 +667,80 @@ bool Window::GrabMouse(bool on_off)
                                 PointerMotionMask | ButtonMotionMask;
         // okay.. so there's no way to figure out what is the current cursor ?
         // and this stupid API requires a cursor to be given.. (why in the f*?)
-        const auto cursor = pimpl_->cursor ? XCreateFontCursor(display, 2) : X11_None;
-        return XGrabPointer(display,
+        if (pimpl_->cursor && !pimpl_->grab_cursor)
+            pimpl_->grab_cursor = XCreateFontCursor(display, 2);
+
+        const auto cursor = pimpl_->cursor ? pimpl_->grab_cursor : X11_None;
+        pimpl_->mouse_grab = XGrabPointer(display,
                             pimpl_->window, False, event_mask,
                             GrabModeAsync, GrabModeAsync,
                             pimpl_->window, cursor,
                             CurrentTime) == Success;
+        return pimpl_->mouse_grab;
+    }
+    pimpl_->mouse_grab = false;
+    return XUngrabPointer(display, CurrentTime) == Success;
+}
+
+bool Window::SetRelativeMouseMode(bool on)
+{
+    assert(DoesExist());
+
+    if (pimpl_->relative_mouse == on)
+        return true;
+
+    connection& conn = *pimpl_->conn;
+    ::Display* d = conn.display;
+
+    if (on)
+    {
+        // only one window on the connection can be in relative mode.
+        unsigned long none = 0;
+        if (!conn.relative_mouse_window.compare_exchange_strong(none, pimpl_->window))
+            return false;
+
+        if (!InitXInput2(d))
+        {
+            conn.relative_mouse_window = 0;
+            return false;
+        }
+
+        // hide the cursor and confine it to the window. the pointer
+        // never needs to be warped since the motion comes from the raw events.
+        if (!pimpl_->invisible_cursor)
+            pimpl_->invisible_cursor = CreateInvisibleCursor(d, pimpl_->window);
+
+        const auto event_mask = ButtonPressMask | ButtonReleaseMask |
+                                PointerMotionMask | ButtonMotionMask;
+        if (XGrabPointer(d, pimpl_->window, False, event_mask,
+                GrabModeAsync, GrabModeAsync,
+                pimpl_->window, pimpl_->invisible_cursor,
+                CurrentTime) != Success)
+        {
+            conn.relative_mouse_window = 0;
+            return false;
+        }
+
+        SelectRawMotion(d, true);
     }
     else
     {
-        return XUngrabPointer(display, CurrentTime) == Success;
+        SelectRawMotion(d, false);
+        XUngrabPointer(d, CurrentTime);
+        conn.relative_mouse_window = 0;
+        pimpl_->mouse_grab = false;
     }
-    pimpl_->mouse_grab = on_off;
+    XFlush(d);
+
+    pimpl_->relative_mouse = on;
+    return true;
 }
 
 void Window::SetFocus()
 {
     assert(DoesExist());
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->conn->display;
 
     XRaiseWindow(d, pimpl_->window);
     XSetInputFocus(d, pimpl_->window, X11_RevertToNone, CurrentTime);
@@ -372,10 +754,12 @@ void Window::SetSize(uint_t width, uint_t height)
     assert(DoesExist());
     assert(!IsFullscreen());
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->conn->display;
 
     XResizeWindow(d, pimpl_->window, width, height);
     XFlush(d);
+
+    pimpl_->geometry.size_valid = false;
 }
 
 void Window::SetEncoding(Encoding enc)
@@ -383,11 +767,21 @@ void Window::SetEncoding(Encoding enc)
     pimpl_->enc = enc;
 }
 
+void Window::SetResizeCoalescing(bool on)
+{
+    pimpl_->coalesce_resize = on;
+}
+
+void Window::SetCreateTimeout(ms_t timeout)
+{
+    pimpl_->create_timeout = timeout;
+}
+
 void Window::SetTitle(const std::string& title)
 {
     assert(DoesExist());
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->conn->display;
 
     // todo: work out the actual encoding. we could have to do
     // a conversion from UTF-8 to "Host portable character encoding"
@@ -396,31 +790,59 @@ void Window::SetTitle(const std::string& title)
     XFlush(d);
 }
 
-bool Window::ProcessEvent(const native_event_t& ev)
+bool Window::DecodeEvent(const native_event_t& ev, WindowEvent* events, unsigned& count,
+    bitflag<WindowEvent::Type> wanted)
 {
+    count = 0;
+
     if (ev.get_window_handle() != GetNativeHandle())
         return false;
 
     const XEvent& event = ev;
 
+    WindowEvent& out = events[0];
+
     switch (event.type)
     {
+        case RawMotionEvent:
+            {
+                if (!wanted.test(WindowEvent::Type::RawMouseMove))
+                    break;
+
+                double delta[2];
+                std::memcpy(delta, &event.xclient.data, sizeof(delta));
+
+                out.type = WindowEvent::Type::RawMouseMove;
+                out.raw_mouse_move = WindowEventRawMouseMove{};
+                out.raw_mouse_move.dx = delta[0];
+                out.raw_mouse_move.dy = delta[1];
+                count = 1;
+            }
+            break;
+
         case MotionNotify:
-            if (OnMouseMove)
             {
+                if (!wanted.test(WindowEvent::Type::MouseMove))
+                    break;
+
                 WindowEventMouseMove mickey = {};
                 mickey.window_x = event.xmotion.x;
                 mickey.window_y = event.xmotion.y;
                 mickey.global_x = event.xmotion.x_root;
                 mickey.global_y = event.xmotion.y_root;
-                OnMouseMove(mickey);
+                mickey.samples  = ev.get_sample_count();
+                out.type = WindowEvent::Type::MouseMove;
+                out.mouse_move = mickey;
+                count = 1;
             }
             break;
 
         case ButtonPress:
-            if (OnMousePress)
             {
-                const auto& button = TranslateMouseButtonEvent(ev);
+                if (!wanted.test(WindowEvent::Type::MousePress))
+                    break;
+
+                const auto& button = TranslateMouseButtonEvent(*pimpl_->conn, ev);
 
                 WindowEventMousePress mickey = {};
                 mickey.window_x = event.xbutton.x;
@@ -429,14 +851,18 @@ bool Window::ProcessEvent(const native_event_t& ev)
                 mickey.global_y = event.xbutton.y_root;
                 mickey.modifiers = button.first;
                 mickey.btn       = button.second;
-                OnMousePress(mickey);
+                out.type = WindowEvent::Type::MousePress;
+                out.mouse_press = mickey;
+                count = 1;
             }
             break;
 
         case ButtonRelease:
-            if (OnMouseRelease)
             {
-                const auto& button = TranslateMouseButtonEvent(ev);
+                if (!wanted.test(WindowEvent::Type::MouseRelease))
+                    break;
+
+                const auto& button = TranslateMouseButtonEvent(*pimpl_->conn, ev);
 
                 WindowEventMouseRelease mickey = {};
                 mickey.window_x = event.xbutton.x;
@@ -445,117 +871,169 @@ bool Window::ProcessEvent(const native_event_t& ev)
                 mickey.global_y = event.xbutton.y_root;
                 mickey.modifiers = button.first;
                 mickey.btn       = button.second;
-                OnMouseRelease(mickey);
+                out.type = WindowEvent::Type::MouseRelease;
+                out.mouse_release = mickey;
+                count = 1;
             }
             break;
 
         case FocusIn:
-            if (OnGainFocus)
-                OnGainFocus(WindowEventGainFocus{});
+            if (wanted.test(WindowEvent::Type::GainFocus))
+            {
+                out.type = WindowEvent::Type::GainFocus;
+                count = 1;
+            }
             break;
 
         case FocusOut:
-            if (OnLostFocus)
-                OnLostFocus(WindowEventLostFocus{});
+            if (wanted.test(WindowEvent::Type::LostFocus))
+            {
+                out.type = WindowEvent::Type::LostFocus;
+                count = 1;
+            }
             break;
 
         case Expose:
-            if (OnPaint)
             {
-                WindowEventPaint paint = {0};
-                paint.x      = event.xexpose.x;
-                paint.y      = event.xexpose.y;
-                paint.width  = event.xexpose.width;
-                paint.height = event.xexpose.height;
-                OnPaint(paint);
+                if (event.xexpose.width && event.xexpose.height)
+                {
+                    AddDamage(pimpl_->damage,
+                        event.xexpose.x,
+                        event.xexpose.y,
+                        event.xexpose.width,
+                        event.xexpose.height);
+                }
+                // more expose events follow in this sequence.
+                if (event.xexpose.count)
+                    break;
+
+                pimpl_->paint_pending = false;
+                if (!pimpl_->damage.num_rects)
+                    break;
+
+                if (wanted.test(WindowEvent::Type::Paint))
+                {
+                    out.type  = WindowEvent::Type::Paint;
+                    out.paint = pimpl_->damage;
+                    count = 1;
+                }
+                pimpl_->damage = WindowEventPaint{};
             }
             break;
 
         case ConfigureNotify:
-            if (pimpl_->width != event.xconfigure.width || pimpl_->height != event.xconfigure.height)
             {
-                pimpl_->width  = event.xconfigure.width;
-                pimpl_->height = event.xconfigure.height;
-                if (OnResize)
+                XConfigureEvent configure = event.xconfigure;
+
+                // skip ahead to the latest configure event for this window
+                // so that a burst of resizes only results in a single OnResize.
+                if (pimpl_->coalesce_resize)
+                {
+                    ::Display* d = pimpl_->conn->display;
+                    XEvent next;
+                    while (XCheckTypedWindowEvent(d, pimpl_->window, ConfigureNotify, &next))
+                        configure = next.xconfigure;
+                }
+
+                auto& geom  = pimpl_->geometry;
+                geom.width  = configure.width;
+                geom.height = configure.height;
+                // the coordinates are relative to the parent window unless
+                // the event was sent by the window manager in which case
+                // they're in root window coordinates. (ICCCM 4.1.5)
+                if (configure.send_event || !geom.reparented)
                 {
+                    geom.x = configure.x + configure.border_width;
+                    geom.y = configure.y + configure.border_width;
+                    geom.origin_valid = true;
+                }
+                else geom.origin_valid = false;
+
+                if (pimpl_->width != configure.width || pimpl_->height != configure.height)
+                {
+                    pimpl_->width  = configure.width;
+                    pimpl_->height = configure.height;
+                    if (!wanted.test(WindowEvent::Type::Resize))
+                        break;
+
                     WindowEventResize resize = {0};
-                    resize.width  = event.xconfigure.width;
-                    resize.height = event.xconfigure.height;
-                    OnResize(resize);
+                    resize.width  = configure.width;
+                    resize.height = configure.height;
+                    out.type   = WindowEvent::Type::Resize;
+                    out.resize = resize;
+                    count = 1;
                 }
             }
             break;
 
+        case MapNotify:
+            // the same event is also reported through the root window.
+            if (event.xmap.event == event.xmap.window && wanted.test(WindowEvent::Type::Show))
+            {
+                out.type = WindowEvent::Type::Show;
+                count = 1;
+            }
+            break;
+
+        case ReparentNotify:
+            {
+                ::Display* d = pimpl_->conn->display;
+                pimpl_->geometry.reparented   = event.xreparent.parent != RootWindow(d, DefaultScreen(d));
+                pimpl_->geometry.origin_valid = false;
+            }
+            break;
+
+        case PropertyNotify:
+            if (event.xproperty.atom == pimpl_->conn->atoms._NET_FRAME_EXTENTS)
+                pimpl_->geometry.frame_valid = false;
+            break;
+
         case CreateNotify:
-            if (OnCreate)
             {
+                if (!wanted.test(WindowEvent::Type::Create))
+                    break;
+
                 WindowEventCreate create = {0};
                 create.x      = event.xcreatewindow.x;
                 create.y      = event.xcreatewindow.y;
                 create.width  = event.xcreatewindow.width;
                 create.height = event.xcreatewindow.height;
-                OnCreate(create);
+                out.type   = WindowEvent::Type::Create;
+                out.create = create;
+                count = 1;
             }
             break;
 
 
         case ClientMessage:
-            if ((Atom)event.xclient.data.l[0] == WM_DELETE_WINDOW)
+            if ((Atom)event.xclient.data.l[0] == pimpl_->conn->atoms.WM_DELETE_WINDOW &&
+                wanted.test(WindowEvent::Type::WantClose))
             {
-                if (OnWantClose)
-                    OnWantClose(WindowEventWantClose{});
+                out.type = WindowEvent::Type::WantClose;
+                count = 1;
             }
             break;
 
         case KeyPress:
-            if (OnKeyDown)
-            {
-                const auto& keys = TranslateKeydownEvent(ev);
-                if (keys.second != Keysym::None)
-                    OnKeyDown(WindowEventKeyDown{keys.second, keys.first});
-            }
-            if (OnChar)
             {
-                KeySym sym = NoSymbol;
-                XLookupString(const_cast<XKeyEvent*>(&event.xkey), nullptr, 0, &sym, nullptr);
-                if (sym == NoSymbol)
+                if (wanted.test(WindowEvent::Type::KeyDown))
+                {
+                    const auto& keys = TranslateKeydownEvent(*pimpl_->conn, ev);
+                    if (keys.second != Keysym::None)
+                    {
+                        events[count].type = WindowEvent::Type::KeyDown;
+                        events[count].key_down = WindowEventKeyDown{keys.second, keys.first};
+                        ++count;
+                    }
+                }
+                if (!wanted.test(WindowEvent::Type::Char))
                     break;
 
-                const long ucs2 = linux::keysym2ucs(sym);
+                const long ucs2 = TranslateCharacter(*pimpl_->conn, event.xkey);
                 if (ucs2 == -1)
                     break;
 
-                // simulate WM_CHAR and synthesize a character event
-                // note that ClientMessage didn't work as expected.
-                static_assert(sizeof(Window) >= sizeof(ucs2), "");
-
-                XEvent hack;
-                std::memset(&hack, 0, sizeof(hack));
-                hack.type        = MapNotify;
-                hack.xmap.event  = ucs2;
-                hack.xmap.window = GetNativeHandle();
-                XSendEvent(event.xany.display, GetNativeHandle(), False, 0, &hack);
-            }
-            break;
-
-        case KeyRelease:
-            if (OnKeyUp)
-            {
-                const auto& keys = TranslateKeydownEvent(ev);
-                if (keys.second != Keysym::None)
-                    OnKeyUp(WindowEventKeyUp{keys.second, keys.first});
-            }
-            break;
-
-        case MapNotify:
-            if (!event.xany.send_event)
-                break;
-
-            if (OnChar)
-            {
-                const XMapEvent& uchar = event.xmap;
-                const long ucs2 = (long)uchar.event;
-
+                // deliver the character right after the key down.
                 WindowEventChar c = {0};
 
                 if (pimpl_->enc == Encoding::ASCII)
@@ -565,7 +1043,24 @@ bool Window::ProcessEvent(const native_event_t& ev)
                 else if (pimpl_->enc == Encoding::UTF8)
                     enc::utf8_encode(&ucs2, &ucs2 + 1, &c.utf8[0]);
 
-                OnChar(c);
+                events[count].type = WindowEvent::Type::Char;
+                events[count].character = c;
+                ++count;
+            }
+            break;
+
+        case KeyRelease:
+            {
+                if (!wanted.test(WindowEvent::Type::KeyUp))
+                    break;
+
+                const auto& keys = TranslateKeydownEvent(*pimpl_->conn, ev);
+                if (keys.second != Keysym::None)
+                {
+                    out.type = WindowEvent::Type::KeyUp;
+                    out.key_up = WindowEventKeyUp{keys.second, keys.first};
+                    count = 1;
+                }
             }
             break;
 
@@ -577,156 +1072,45 @@ uint_t Window::GetSurfaceWidth() const
 {
     assert(DoesExist());
 
-    Display* d = GetNativeDisplayHandle();
-
-    XWindowAttributes attrs;
-    XGetWindowAttributes(d, pimpl_->window, &attrs);
-
-    return attrs.width;
+    RefreshSize(*pimpl_->conn, pimpl_->window, pimpl_->geometry);
+    return pimpl_->geometry.width;
 }
 
 uint_t Window::GetSurfaceHeight() const
 {
     assert(DoesExist());
 
-    Display* d = GetNativeDisplayHandle();
-
-    XWindowAttributes attrs;
-    XGetWindowAttributes(d, pimpl_->window, &attrs);
-
-    return attrs.height;
+    RefreshSize(*pimpl_->conn, pimpl_->window, pimpl_->geometry);
+    return pimpl_->geometry.height;
 }
 
 int Window::GetPosX() const
 {
-    assert(DoesExist());
-
-    ::Display* d = GetNativeDisplayHandle();
-
-    ::Window root_window = X11_None;
-    ::Window parent_window = X11_None;
-    ::Window* child_windows = nullptr;
-    unsigned int num_children = 0;
-    ::XQueryTree(d, pimpl_->window, &root_window, &parent_window, &child_windows, &num_children);
-    if (child_windows)
-        ::XFree(child_windows);
-
-    assert(root_window == RootWindow(d, DefaultScreen(d)));
-
-    ::Window the_window = pimpl_->window;
-
-    // the big problem here is that our window can have been reparented
-    // by the WM and the parent window *might* (or might not) contain
-    // decorations such as border / title bar depending on the window manager.
-    // Mapping the 0, 0 coordinate using our Window handle might not then map
-    // to the top left corner of the "window" that user sees but refers only
-    // to the drawable client area inside the window captions.
-    //
-    // Some potential ways to try to "fix" could be to try to query the WM
-    // for window frame extents (but how to get the title bar?)
-    // or then try to look for a parent window of this window and try to
-    // use that as the window to map the coordinate from into desktop coordinate.
-    //
-    // Both are likely to fail randomly under different window manager systems.
-    //
-
-    // maybe the WM has reparanted the window and the WM parent window
-    // includes "our" window and some decorations.
-    if (parent_window != root_window)
-        the_window = parent_window;
-
-    ::Window child_dummy = X11_None;
-    int x = 0;
-    int y = 0;
-
-    // Translate the position 0,0 in our target window to root window coordinate space.
-    ::XTranslateCoordinates(d, the_window, root_window, 0, 0, &x, &y, &child_dummy);
-
-    Atom actual_type;
-    int actual_format = 0;
-    unsigned long nitems, bytes_after;
-    unsigned char *data = nullptr;
-    if (::XGetWindowProperty(d, pimpl_->window,
-        ::XInternAtom(d, "_NET_FRAME_EXTENTS", 0),
-        0, 4, False, AnyPropertyType,
-        &actual_type, &actual_format,
-        &nitems, &bytes_after, &data) == Success)
-    {
-        const auto border_left   = ((const uint32_t*)data)[0];
-        const auto border_right  = ((const uint32_t*)data)[1];
-        const auto border_top    = ((const uint32_t*)data)[2];
-        const auto border_bottom = ((const uint32_t*)data)[3];
-        ::XFree(data);
-
-        x = x - border_left;
-    }
-    return x;
+    return GetGeometry().x;
 }
 
 int Window::GetPosY() const
 {
-    assert(DoesExist());
-
-    ::Display* d = GetNativeDisplayHandle();
-
-    ::Window root_window = X11_None;
-    ::Window parent_window = X11_None;
-    ::Window* child_windows = nullptr;
-    unsigned int num_children = 0;
-    ::XQueryTree(d, pimpl_->window, &root_window, &parent_window, &child_windows, &num_children);
-    if (child_windows)
-        ::XFree(child_windows);
-
-    assert(root_window == RootWindow(d, DefaultScreen(d)));
-
-    ::Window the_window = pimpl_->window;
-
-    // the big problem here is that our window can have been reparented
-    // by the WM and the parent window *might* (or might not) contain
-    // decorations such as border / title bar depending on the window manager.
-    // Mapping the 0, 0 coordinate using our Window handle might not then map
-    // to the top left corner of the "window" that user sees but refers only
-    // to the drawable client area inside the window captions.
-    //
-    // Some potential ways to try to "fix" could be to try to query the WM
-    // for window frame extents (but how to get the title bar?)
-    // or then try to look for a parent window of this window and try to
-    // use that as the window to map the coordinate from into desktop coordinate.
-    //
-    // Both are likely to fail randomly under different window manager systems.
-    //
-
-    // maybe the WM has reparanted the window and the WM parent window
-    // includes "our" window and some decorations.
-    if (parent_window != root_window)
-        the_window = parent_window;
-
-    ::Window child_dummy = X11_None;
-    int x = 0;
-    int y = 0;
+    return GetGeometry().y;
+}
 
-    // Translate the position 0,0 in our target window to root window coordinate space.
-    ::XTranslateCoordinates(d, the_window, root_window, 0, 0, &x, &y, &child_dummy);
-
-    Atom actual_type;
-    int actual_format = 0;
-    unsigned long nitems, bytes_after;
-    unsigned char *data = nullptr;
-    if (::XGetWindowProperty(d, pimpl_->window,
-        ::XInternAtom(d, "_NET_FRAME_EXTENTS", 0),
-        0, 4, False, AnyPropertyType,
-        &actual_type, &actual_format,
-        &nitems, &bytes_after, &data) == Success)
-    {
-        const auto border_left   = ((const uint32_t*)data)[0];
-        const auto border_right  = ((const uint32_t*)data)[1];
-        const auto border_top    = ((const uint32_t*)data)[2];
-        const auto border_bottom = ((const uint32_t*)data)[3];
-        ::XFree(data);
+Window::Geometry Window::GetGeometry() const
+{
+    assert(DoesExist());
 
-        y = y - border_top;
-    }
-    return y;
+    // The window manager may have reparented the window into a frame
+    // with decorations such as border and title bar. The position is
+    // the top left corner of the frame which is found by taking out
+    // the frame extents published by the window manager.
+    auto& geom = pimpl_->geometry;
+    RefreshGeometry(*pimpl_->conn, pimpl_->window, geom);
+
+    Geometry ret;
+    ret.x = geom.x - geom.frame_left;
+    ret.y = geom.y - geom.frame_top;
+    ret.width  = geom.width;
+    ret.height = geom.height;
+    return ret;
 }
 
 bool Window::DoesExist() const
@@ -754,7 +1138,7 @@ std::pair<uint_t, uint_t> Window::GetMinSize() const
 {
     assert(DoesExist());
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->conn->display;
 
     XSizeHints* hints = XAllocSizeHints();
 
@@ -783,7 +1167,7 @@ std::pair<uint_t, uint_t> Window::GetMaxSize() const
 {
     assert(DoesExist());
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->conn->display;
 
     XSizeHints* hints = XAllocSizeHints();
 
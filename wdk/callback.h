@@ -23,54 +23,214 @@
 #pragma once
 
 #include <functional>
-#include <vector>
+#include <deque>
+#include <cstdint>
 
 namespace wdk
 {
+    // Handle to a handler bound to an EventCallback.
+    // A default constructed subscription doesn't refer to any handler.
+    struct Subscription {
+        std::uint32_t index = ~0u;
+        std::uint32_t generation = 0;
+
+        bool IsValid() const
+        { return index != ~0u; }
+    };
 
     // small wrapper for std::function.
-    // contains a vector of std::function objects that all get
+    // contains a set of std::function objects that all get
     // invoked when the callback is invoked.
+    //
+    // The handlers are kept in a slot map. Binding returns a subscription
+    // handle that can be used to unbind the handler in constant time. The
+    // slot's generation is bumped every time the slot is released so that
+    // a stale handle never unbinds a handler that later reused the slot.
+    // The first few handlers are stored inline without any allocation.
+    //
+    // Handlers can be bound and unbound while the callback is being invoked
+    // (including a handler unbinding itself). Unbound handlers are not called
+    // anymore but the slots of handlers that might be executing are only
+    // released once the invocation is done. Handlers bound during the
+    // invocation are called the next time.
+    // If a handler throws the exception propagates out of the invocation
+    // and the rest of the handlers are not called.
     template<typename Event>
     class EventCallback
     {
     public:
         using Handler = std::function<void (const Event&)>;
 
-        // 
-        void Bind(const Handler& handler)
+        // Bind a new handler. Returns a handle for unbinding the handler.
+        Subscription Bind(const Handler& handler)
         {
-            handlers_.push_back(handler);
+            return Bind(Handler(handler));
         }
-        // Bind a new handler 
-        void Bind(Handler&& handler)
+        // Bind a new handler. Returns a handle for unbinding the handler.
+        Subscription Bind(Handler&& handler)
         {
-            handlers_.push_back(std::move(handler));
+            std::uint32_t index = free_;
+            if (index != NoSlot)
+            {
+                free_ = GetSlot(index).next;
+            }
+            else
+            {
+                index = slots_++;
+                if (index >= InlineSlots)
+                    overflow_.emplace_back();
+            }
+            Slot& slot   = GetSlot(index);
+            slot.handler = std::move(handler);
+            slot.live    = true;
+            // a running invocation skips the handler.
+            slot.bound   = invocations_;
+            ++live_;
+            return Subscription{index, slot.generation};
+        }
+        // Unbind the handler identified by the subscription.
+        // Returns false if the handler was already unbound.
+        bool Unbind(const Subscription& subscription)
+        {
+            if (subscription.index >= slots_)
+                return false;
+            Slot& slot = GetSlot(subscription.index);
+            if (!slot.live || slot.generation != subscription.generation)
+                return false;
+
+            Release(subscription.index);
+            return true;
         }
         // Invoke the handlers.
-        void operator()(const Event& event) const
+        void operator()(const Event& event)
         {
-            for (auto& handler : handlers_)
-                handler(event);
+            Invoke(event);
         }
         // Invoke the handlers.
-        void Invoke(const Event& event) const
+        void Invoke(const Event& event)
         {
-            for (auto& handler : handlers_)
-                handler(event);
+            InvokeScope scope(*this);
+
+            // handlers bound from now on have this invocation's number
+            // and are only called by the next one.
+            const std::uint64_t invocation = ++invocations_;
+            const std::uint32_t slots = slots_;
+            const std::uint32_t count = slots < InlineSlots ? slots : InlineSlots;
+            for (std::uint32_t i=0; i<count; ++i)
+            {
+                if (inline_[i].live && inline_[i].bound < invocation)
+                    inline_[i].handler(event);
+            }
+            for (std::uint32_t i=InlineSlots; i<slots; ++i)
+            {
+                const Slot& slot = overflow_[i - InlineSlots];
+                if (slot.live && slot.bound < invocation)
+                    slot.handler(event);
+            }
         }
 
+        // Returns true if there are any handlers bound.
         operator bool() const
-        { return !handlers_.empty(); }
+        { return live_ != 0; }
+
+        // Get the number of handlers bound.
+        std::size_t GetHandlerCount() const
+        { return live_; }
 
+        // Unbind all the handlers.
         void Clear() noexcept
         {
-            for (auto& handler : handlers_)
-                handler = nullptr;
+            for (std::uint32_t i=0; i<slots_; ++i)
+            {
+                if (GetSlot(i).live)
+                    Release(i);
+            }
+        }
+
+    private:
+        static const std::uint32_t NoSlot = ~0u;
+        static const std::uint32_t InlineSlots = 3;
+
+        struct Slot {
+            Handler handler;
+            // the invocation count when the handler was bound.
+            std::uint64_t bound = 0;
+            std::uint32_t generation = 0;
+            std::uint32_t next = NoSlot;
+            bool live = false;
+        };
+
+        // Keeps track of the invocation depth and releases the
+        // slots unbound during the invocation once it's done, also
+        // when a handler throws.
+        struct InvokeScope {
+            EventCallback& callback;
+            InvokeScope(EventCallback& cb) : callback(cb)
+            { ++callback.invoking_; }
+           ~InvokeScope()
+            {
+                if (--callback.invoking_ == 0)
+                    callback.ReleaseDeferred();
+            }
+            InvokeScope(const InvokeScope&) = delete;
+            InvokeScope& operator=(const InvokeScope&) = delete;
+        };
+
+        Slot& GetSlot(std::uint32_t index)
+        {
+            return index < InlineSlots ? inline_[index] : overflow_[index - InlineSlots];
+        }
+
+        void Release(std::uint32_t index) noexcept
+        {
+            Slot& slot = GetSlot(index);
+            slot.live = false;
+            slot.generation++;
+            --live_;
+            // the handler might be executing right now, defer destroying
+            // it until the invocation is done. a handler bound after the
+            // latest invocation started can't have been called yet.
+            if (invoking_ && slot.bound != invocations_)
+            {
+                slot.next = deferred_;
+                deferred_ = index;
+                return;
+            }
+            slot.handler = nullptr;
+            slot.next = free_;
+            free_ = index;
+        }
+
+        void ReleaseDeferred() noexcept
+        {
+            while (deferred_ != NoSlot)
+            {
+                const std::uint32_t index = deferred_;
+                Slot& slot = GetSlot(index);
+                deferred_    = slot.next;
+                slot.handler = nullptr;
+                slot.next    = free_;
+                free_        = index;
+            }
         }
 
     private:
-        std::vector<Handler> handlers_;
+        Slot inline_[InlineSlots];
+        // deque so that growing it doesn't move the handlers
+        // that might be executing.
+        std::deque<Slot> overflow_;
+        // number of slots in use (inline and overflow)
+        std::uint32_t slots_ = 0;
+        // number of live handlers
+        std::uint32_t live_ = 0;
+        // head of the list of free slots
+        std::uint32_t free_ = NoSlot;
+        // head of the list of slots waiting to be released
+        std::uint32_t deferred_ = NoSlot;
+        // invocation depth.
+        unsigned invoking_ = 0;
+        // number of invocations so far.
+        std::uint64_t invocations_ = 0;
     };
 
 } // wdk
@@ -0,0 +1,202 @@
+// Copyright (c) 2016 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include <unordered_map>
+#include <condition_variable>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+#include "wdk/dispatcher.h"
+#include "wdk/window.h"
+#include "wdk/system.h"
+
+namespace {
+    using namespace wdk;
+
+    struct handle_hash {
+        std::size_t operator()(const native_window_t& handle) const
+        {
+            // X11 window is an XID and Win32 window is a HWND.
+            // Either one can be hashed simply as an integer.
+            return std::hash<std::uintptr_t>()((std::uintptr_t)handle);
+        }
+    };
+
+    struct window_entry {
+        Window* window = nullptr;
+        // the number of events being dispatched to the window right now.
+        unsigned dispatching = 0;
+    };
+    using window_entry_ptr = std::shared_ptr<window_entry>;
+
+    // The windows can be created and destroyed on any thread while another
+    // thread is dispatching. The lock is only held for looking up the window,
+    // the entry keeps count of the events being dispatched to it so that
+    // removing a window can wait for just those.
+    struct window_table {
+        std::mutex mutex;
+        // signaled when an event has been dispatched.
+        std::condition_variable dispatched;
+        std::unordered_map<native_window_t, window_entry_ptr, handle_hash> windows;
+    };
+
+    window_table& GetWindowTable()
+    {
+        static window_table table;
+        return table;
+    }
+
+    // The windows the calling thread is dispatching to. An event handler
+    // can destroy its own window so the thread must not wait for itself.
+    std::vector<const window_entry*>& GetThreadDispatches()
+    {
+        thread_local std::vector<const window_entry*> entries;
+        return entries;
+    }
+
+    // Marks the event being dispatched to the window for
+    // the duration of the dispatch, also when a handler throws.
+    class dispatch_scope
+    {
+    public:
+        dispatch_scope(window_table& table, window_entry_ptr entry)
+            : table_(table), entry_(std::move(entry))
+        {
+            GetThreadDispatches().push_back(entry_.get());
+        }
+       ~dispatch_scope()
+        {
+            GetThreadDispatches().pop_back();
+
+            std::lock_guard<std::mutex> lock(table_.mutex);
+            --entry_->dispatching;
+            table_.dispatched.notify_all();
+        }
+        dispatch_scope(const dispatch_scope&) = delete;
+        dispatch_scope& operator=(const dispatch_scope&) = delete;
+    private:
+        window_table& table_;
+        window_entry_ptr entry_;
+    };
+
+} // namespace
+
+namespace wdk
+{
+
+bool EventDispatcher::Dispatch(const native_event_t& ev) const
+{
+    auto& table = GetWindowTable();
+
+    window_entry_ptr entry;
+    {
+        std::lock_guard<std::mutex> lock(table.mutex);
+
+        const auto it = table.windows.find(ev.get_window_handle());
+        if (it != table.windows.end())
+        {
+            entry = it->second;
+            ++entry->dispatching;
+        }
+    }
+
+    if (entry)
+    {
+        Window* window = entry->window;
+        dispatch_scope scope(table, std::move(entry));
+        window->ProcessEvent(ev);
+        return true;
+    }
+
+    if (OnUnknownEvent)
+        OnUnknownEvent(ev);
+
+    return false;
+}
+
+std::size_t EventDispatcher::DispatchPending() const
+{
+    native_event_t events[32];
+
+    std::size_t total = 0;
+    for (;;)
+    {
+        const std::size_t count = PeekEvents(events, 32);
+        for (std::size_t i=0; i<count; ++i)
+            Dispatch(events[i]);
+
+        total += count;
+        if (count < 32)
+            break;
+    }
+    return total;
+}
+
+Window* EventDispatcher::GetWindowByHandle(native_window_t handle)
+{
+    auto& table = GetWindowTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    const auto it = table.windows.find(handle);
+    if (it == table.windows.end())
+        return nullptr;
+    return it->second->window;
+}
+
+void EventDispatcher::AddWindow(native_window_t handle, Window* window)
+{
+    auto& table = GetWindowTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    assert(table.windows.find(handle) == table.windows.end());
+
+    window_entry_ptr entry = std::make_shared<window_entry>();
+    entry->window = window;
+    table.windows[handle] = std::move(entry);
+}
+
+void EventDispatcher::RemoveWindow(native_window_t handle)
+{
+    auto& table = GetWindowTable();
+    std::unique_lock<std::mutex> lock(table.mutex);
+
+    const auto it = table.windows.find(handle);
+    if (it == table.windows.end())
+        return;
+
+    // no new dispatches start once the window is out of the table.
+    const window_entry_ptr entry = it->second;
+    table.windows.erase(it);
+
+    // wait for the events that other threads are dispatching to the window.
+    const auto& own = GetThreadDispatches();
+    const auto own_count = (unsigned)std::count(own.begin(), own.end(), entry.get());
+    table.dispatched.wait(lock, [&]() {
+        return entry->dispatching == own_count;
+    });
+}
+
+} // wdk
@@ -0,0 +1,72 @@
+// Copyright (c) 2016 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#pragma once
+
+#include <functional>
+#include <cstddef>
+
+#include "wdk/types.h"
+
+namespace wdk
+{
+    class Window;
+
+    // Route window system events directly to the windows that own them.
+    // Every window on the default display is added to the dispatcher's
+    // window table when it's created and removed when it's destroyed. Finding the owner of
+    // an event is then a single hash table lookup instead of offering
+    // every event to every window through Window::ProcessEvent.
+    // Windows can be created and destroyed on other threads while events
+    // are being dispatched. The event handlers are not called under any
+    // lock. Destroying a window on one thread while another thread is
+    // dispatching an event to that same window waits until the event
+    // has been processed. Destroying any other window doesn't wait.
+    class EventDispatcher
+    {
+    public:
+        // Invoked with events that don't belong to any wdk window.
+        // For example root window notifications, resolution change
+        // events or events for windows created outside of wdk.
+        std::function<void (const native_event_t&)> OnUnknownEvent;
+
+        // Dispatch the event to the window that owns it.
+        // If the owner was found returns true, otherwise the event
+        // is given to OnUnknownEvent (if any) and false is returned.
+        bool Dispatch(const native_event_t& ev) const;
+
+        // Dispatch all the events that are currently available in the
+        // application's event queue. Returns the number of events dispatched.
+        std::size_t DispatchPending() const;
+
+        // Find the window object that has the given native window handle.
+        // Returns nullptr if there's no such window.
+        static Window* GetWindowByHandle(native_window_t handle);
+
+    private:
+        friend class Window;
+
+        static void AddWindow(native_window_t handle, Window* window);
+        static void RemoveWindow(native_window_t handle);
+    };
+
+} // wdk
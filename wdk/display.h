@@ -0,0 +1,92 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#pragma once
+
+#include <memory>
+#include <chrono>
+#include <functional>
+
+#include "wdk/types.h"
+
+namespace wdk
+{
+    // Breakdown of the time spent setting up a display connection.
+    // On X11 the keyboard tables and the XRandR extension are set up
+    // only when they're first needed, so those stay zero until then.
+    // On Win32 there's no setup and all the times are zero.
+    struct DisplayTimings {
+        // time spent opening the display connection.
+        std::chrono::microseconds open {0};
+        // time spent interning the atoms.
+        std::chrono::microseconds atoms {0};
+        // time spent building the keyboard tables.
+        std::chrono::microseconds keyboard {0};
+        // time spent initializing the XRandR extension.
+        std::chrono::microseconds randr {0};
+    };
+
+    // Connection to the window system and the state that goes with it,
+    // such as the interned atoms, the keyboard tables and the error tracking.
+    // Everything in wdk uses the default display unless a Display is given
+    // explicitly. A Display must only be used by one thread at a time but
+    // different threads can each use their own Display without contending
+    // on a shared connection. The objects created on a display can only be
+    // used with that display and must be destroyed before it.
+    // The event dispatcher, the input thread, the input snapshot and the
+    // video mode functions always use the default display.
+    // On Win32 this is the desktop device context.
+    class Display
+    {
+    public:
+        // Open a new connection to the window system.
+        // Throws std::runtime_error if the connection can't be opened.
+        Display();
+       ~Display();
+
+        // Get the native display handle.
+        // On X11 this is the Display object, on Win32 the desktop HDC.
+        native_display_t GetNativeHandle() const;
+
+        // Get the time spent setting up this display.
+        DisplayTimings GetTimings() const;
+
+        // Add a function to be called when the display is closed, before
+        // the native connection is closed. This is for releasing the state
+        // that is kept per native display handle (such as the EGL display)
+        // since a display opened later can get the same handle.
+        // The handler must not throw.
+        void AddCloseHandler(std::function<void ()> handler);
+
+        // Get the default display. It's opened on first use and it's
+        // the display returned by GetNativeDisplayHandle.
+        static Display& GetDefault();
+
+        Display(const Display&) = delete;
+        Display& operator=(const Display&) = delete;
+    private:
+        struct impl;
+
+        std::unique_ptr<impl> pimpl_;
+    };
+
+} // wdk
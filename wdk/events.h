@@ -50,13 +50,34 @@ namespace wdk
     // When this message is sent depends on the implementation
     // and its understanding of when the contents of the window
     // have become invalid and need repainting.
+    // The x, y, width and height describe the bounding rectangle
+    // of the whole dirty region and the individual dirty rectangles
+    // are listed in rects.
     struct WindowEventPaint {
         int x = 0;
         int y = 0;                      // x, y origin of the dirty rectangle (top left corner within the window)
         int width  = 0;                 // width of the dirty rect
         int height = 0;                 // height of the dirty rect
+
+        struct Rect {
+            int x = 0;
+            int y = 0;
+            int width  = 0;
+            int height = 0;
+        };
+        // maximum number of dirty rectangles carried in the event.
+        // if the region has more rectangles the rest are merged into the last one.
+        static const unsigned MaxRects = 16;
+
+        Rect rects[MaxRects];           // the dirty rectangles
+        unsigned num_rects = 0;         // number of valid rectangles in rects
     };
 
+    // Window has been mapped and is now visible on the screen.
+    // This is also the notification that a window created without
+    // waiting for it to become visible is ready. (See Window::SetCreateTimeout)
+    struct WindowEventShow {};
+
     // Window has been resized.
     struct WindowEventResize {
         int width  = 0;                     // new surface width
@@ -117,6 +138,10 @@ namespace wdk
         MouseButton btn = MouseButton::None;   
         // Keyboard modifiers if any.
         bitflag<Keymod> modifiers;
+
+        // number of raw mouse motion events that were coalesced
+        // into this event. See SetMouseMoveCoalescing.
+        unsigned samples = 1;
     };
 
     // A mouse button was clicked in the window area.
@@ -153,6 +178,15 @@ namespace wdk
         bitflag<Keymod> modifiers;
     };
 
+    // Raw relative mouse motion. This is only delivered when the
+    // window is in relative mouse mode. (See Window::SetRelativeMouseMode)
+    // The deltas are in device units without any pointer acceleration
+    // applied and can have a fractional part.
+    struct WindowEventRawMouseMove {
+        double dx = 0.0;
+        double dy = 0.0;
+    };
+
 
     // This event indicates that the system's video mode/resolution
     // was changed.
@@ -163,6 +197,65 @@ namespace wdk
         unsigned yres = 0;
     };
 
+    // A decoded window event. Holds any one of the window events above
+    // tagged with its type. See Window::DecodeEvent.
+    struct WindowEvent {
+        enum class Type {
+            None,
+            Create, Show, Paint, Resize, GainFocus, LostFocus, WantClose,
+            KeyDown, KeyUp, Char,
+            MouseMove, MousePress, MouseRelease, RawMouseMove
+        };
+        Type type = Type::None;
+
+        union {
+            WindowEventCreate       create;
+            WindowEventShow         show;
+            WindowEventPaint        paint;
+            WindowEventResize       resize;
+            WindowEventGainFocus    gain_focus;
+            WindowEventLostFocus    lost_focus;
+            WindowEventWantClose    want_close;
+            WindowEventKeyDown      key_down;
+            WindowEventKeyUp        key_up;
+            WindowEventChar         character;
+            WindowEventMouseMove    mouse_move;
+            WindowEventMousePress   mouse_press;
+            WindowEventMouseRelease mouse_release;
+            WindowEventRawMouseMove raw_mouse_move;
+        };
+        WindowEvent() {}
+    };
+
+    // Dispatch the decoded event to the matching On* method of the listener.
+    // The listener is any type that has all the On* methods such as a
+    // WindowListener or a class derived from StaticWindowListener.
+    // The calls are resolved at compile time and can be inlined.
+    template<typename Listener>
+    void Dispatch(const WindowEvent& event, Listener& listener)
+    {
+        using Type = WindowEvent::Type;
+        switch (event.type)
+        {
+            case Type::Create:       listener.OnCreate(event.create);             break;
+            case Type::Show:         listener.OnShow(event.show);                 break;
+            case Type::Paint:        listener.OnPaint(event.paint);               break;
+            case Type::Resize:       listener.OnResize(event.resize);             break;
+            case Type::GainFocus:    listener.OnGainFocus(event.gain_focus);      break;
+            case Type::LostFocus:    listener.OnLostFocus(event.lost_focus);      break;
+            case Type::WantClose:    listener.OnWantClose(event.want_close);      break;
+            case Type::KeyDown:      listener.OnKeyDown(event.key_down);          break;
+            case Type::KeyUp:        listener.OnKeyUp(event.key_up);              break;
+            case Type::Char:         listener.OnChar(event.character);            break;
+            case Type::MouseMove:    listener.OnMouseMove(event.mouse_move);      break;
+            case Type::MousePress:   listener.OnMousePress(event.mouse_press);    break;
+            case Type::MouseRelease: listener.OnMouseRelease(event.mouse_release); break;
+            case Type::RawMouseMove: listener.OnRawMouseMove(event.raw_mouse_move); break;
+            case Type::None:
+                break;
+        }
+    }
+
     template<typename T>
     struct EventTraits;
 
@@ -171,6 +264,10 @@ namespace wdk
         static constexpr auto name = "create";
     };
     template<>
+    struct EventTraits<WindowEventShow> {
+        static constexpr auto name = "show";
+    };
+    template<>
     struct EventTraits<WindowEventPaint> {
         static constexpr auto name = "paint";
     };
@@ -219,6 +316,10 @@ namespace wdk
         static constexpr auto name = "mouse_release";
     };
     template<>
+    struct EventTraits<WindowEventRawMouseMove> {
+        static constexpr auto name = "raw_mouse_move";
+    };
+    template<>
     struct EventTraits<SystemEventResolutionChange> {
         static constexpr auto name = "system_resolution_change";
     };
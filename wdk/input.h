@@ -0,0 +1,86 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#pragma once
+
+#include <bitset>
+
+#include "wdk/keys.h"
+#include "wdk/bitflag.h"
+#include "wdk/types.h"
+
+namespace wdk
+{
+    // Snapshot of the keyboard and mouse state. The state is tracked
+    // from the keyboard and mouse events as they're read from the
+    // event queue so taking a snapshot and testing the state doesn't
+    // need to query the window system.
+    struct InputSnapshot {
+        // the native keycodes that are currently down.
+        std::bitset<256> keycodes;
+        // the virtual keys that are currently down, indexed by Keysym.
+        std::bitset<256> keys;
+        // the mouse buttons that are currently down.
+        bitflag<MouseButton> buttons;
+
+        // the latest mouse position in the coordinates of the
+        // window that received the mouse event.
+        int mouse_window_x = 0;
+        int mouse_window_y = 0;
+        // the latest mouse position in desktop coordinates.
+        int mouse_global_x = 0;
+        int mouse_global_y = 0;
+
+        // Test if the virtual key is down.
+        bool TestKeyDown(Keysym key) const
+        { return keys.test(static_cast<unsigned>(key)); }
+
+        // Test if the key identified by the native keycode is down.
+        bool TestKeyDown(uint_t keycode) const
+        { return keycode < keycodes.size() && keycodes.test(keycode); }
+
+        // Test if the mouse button is down.
+        bool TestButtonDown(MouseButton button) const
+        { return buttons.test(button); }
+
+        // Get the current keyboard modifiers.
+        bitflag<Keymod> GetModifiers() const
+        {
+            bitflag<Keymod> mods;
+            if (TestKeyDown(Keysym::ShiftL) || TestKeyDown(Keysym::ShiftR))
+                mods |= Keymod::Shift;
+            if (TestKeyDown(Keysym::ControlL) || TestKeyDown(Keysym::ControlR))
+                mods |= Keymod::Control;
+            if (TestKeyDown(Keysym::AltL))
+                mods |= Keymod::Alt;
+            return mods;
+        }
+    };
+
+    // Get a snapshot of the current input state as tracked from the events
+    // that have been read with PeekEvent/WaitEvent. Unlike TestKeyDown this
+    // doesn't do a round trip to the window system. The keyboard state is
+    // reseeded when a window gains the input focus and all keys and buttons
+    // are released when the focus is lost.
+    InputSnapshot GetInputSnapshot();
+
+} // wdk
@@ -35,19 +35,22 @@ void Connect(wdk::Window& window, wdk::WindowListener& listener)
 
 #ifdef WDK_MULTIPLE_WINDOW_LISTENERS
     window.OnCreate.Bind(std::bind(&WindowListener::OnCreate, &listener, args::_1));
+    window.OnShow.Bind(std::bind(&WindowListener::OnShow, &listener, args::_1));
     window.OnPaint.Bind(std::bind(&WindowListener::OnPaint, &listener, args::_1));
     window.OnResize.Bind(std::bind(&WindowListener::OnResize, &listener, args::_1));
     window.OnLostFocus.Bind(std::bind(&WindowListener::OnLostFocus, &listener, args::_1));
     window.OnGainFocus.Bind(std::bind(&WindowListener::OnGainFocus, &listener, args::_1));
     window.OnWantClose.Bind(std::bind(&WindowListener::OnWantClose, &listener, args::_1));
-    window.OnKeyDown.Bind(std::bind(&WindowListener::OnKeydown, &listener, args::_1));
-    window.OnKeyUp.Bind(std::bind(&WindowListener::OnKeyup, &listener, args::_1));
+    window.OnKeyDown.Bind(std::bind(&WindowListener::OnKeyDown, &listener, args::_1));
+    window.OnKeyUp.Bind(std::bind(&WindowListener::OnKeyUp, &listener, args::_1));
     window.OnChar.Bind(std::bind(&WindowListener::OnChar, &listener, args::_1));
     window.OnMouseMove.Bind(std::bind(&WindowListener::OnMouseMove, &listener, args::_1));
     window.OnMousePress.Bind(std::bind(&WindowListener::OnMousePress, &listener, args::_1));
     window.OnMouseRelease.Bind(std::bind(&WindowListener::OnMouseRelease, &listener, args::_1));
+    window.OnRawMouseMove.Bind(std::bind(&WindowListener::OnRawMouseMove, &listener, args::_1));
 #else
     window.OnCreate       = std::bind(&WindowListener::OnCreate, &listener, args::_1);
+    window.OnShow         = std::bind(&WindowListener::OnShow, &listener, args::_1);
     window.OnPaint        = std::bind(&WindowListener::OnPaint, &listener, args::_1);
     window.OnResize       = std::bind(&WindowListener::OnResize, &listener, args::_1);
     window.OnLostFocus    = std::bind(&WindowListener::OnLostFocus, &listener, args::_1);
@@ -59,6 +62,7 @@ void Connect(wdk::Window& window, wdk::WindowListener& listener)
     window.OnMouseMove    = std::bind(&WindowListener::OnMouseMove, &listener, args::_1);
     window.OnMousePress   = std::bind(&WindowListener::OnMousePress, &listener, args::_1);
     window.OnMouseRelease = std::bind(&WindowListener::OnMouseRelease, &listener, args::_1);
+    window.OnRawMouseMove = std::bind(&WindowListener::OnRawMouseMove, &listener, args::_1);
 #endif
 
 }
@@ -67,6 +71,7 @@ void Disconnect(wdk::Window& window)
 {
 #ifdef WDK_MULTIPLE_WINDOW_LISTENERS
     window.OnCreate.Clear();
+    window.OnShow.Clear();
     window.OnPaint.Clear();
     window.OnResize.Clear();
     window.OnLostFocus.Clear();
@@ -78,8 +83,10 @@ void Disconnect(wdk::Window& window)
     window.OnMouseMove.Clear();
     window.OnMousePress.Clear();
     window.OnMouseRelease.Clear();
+    window.OnRawMouseMove.Clear();
 #else
     window.OnCreate       = nullptr;
+    window.OnShow         = nullptr;
     window.OnPaint        = nullptr;
     window.OnResize       = nullptr;
     window.OnLostFocus    = nullptr;
@@ -91,6 +98,7 @@ void Disconnect(wdk::Window& window)
     window.OnMouseMove    = nullptr;
     window.OnMousePress   = nullptr;
     window.OnMouseRelease = nullptr;
+    window.OnRawMouseMove = nullptr;
 #endif
 }
 
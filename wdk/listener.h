@@ -25,6 +25,7 @@
 namespace wdk
 {
     struct WindowEventCreate;
+    struct WindowEventShow;
     struct WindowEventPaint;
     struct WindowEventResize;
     struct WindowEventLostFocus;
@@ -36,6 +37,7 @@ namespace wdk
     struct WindowEventMouseMove;
     struct WindowEventMousePress;
     struct WindowEventMouseRelease;
+    struct WindowEventRawMouseMove;
     class  Window;
 
     // Interface for listening to window events. 
@@ -45,6 +47,8 @@ namespace wdk
         virtual ~WindowListener() = default;
         // Invoked on WindowEventCreate message.
         virtual void OnCreate(const WindowEventCreate&) {}
+        // Invoked on WindowEventShow message.
+        virtual void OnShow(const WindowEventShow&) {}
         // Invoked on WindowEventPaint message.
         virtual void OnPaint(const WindowEventPaint&) {}
         // Invoked on WindowEventResize message.
@@ -67,10 +71,36 @@ namespace wdk
         virtual void OnMousePress(const WindowEventMousePress&) {}
         // Invoked on WindowEventMouseRelease message.
         virtual void OnMouseRelease(const WindowEventMouseRelease&) {}
+        // Invoked on WindowEventRawMouseMove message.
+        virtual void OnRawMouseMove(const WindowEventRawMouseMove&) {}
     protected:
     private:
     };
 
+    // Base class for listeners used with the compile time dispatch
+    // (Window::ProcessEvent(ev, listener)). Provides empty non-virtual
+    // handlers so that the derived class only needs to define the
+    // handlers it's interested in. The derived class' methods hide
+    // the base methods and are called directly without any indirection.
+    class StaticWindowListener
+    {
+    public:
+        void OnCreate(const WindowEventCreate&) {}
+        void OnShow(const WindowEventShow&) {}
+        void OnPaint(const WindowEventPaint&) {}
+        void OnResize(const WindowEventResize&) {}
+        void OnLostFocus(const WindowEventLostFocus&) {}
+        void OnGainFocus(const WindowEventGainFocus&) {}
+        void OnWantClose(const WindowEventWantClose&) {}
+        void OnKeyDown(const WindowEventKeyDown&) {}
+        void OnKeyUp(const WindowEventKeyUp&) {}
+        void OnChar(const WindowEventChar&) {}
+        void OnMouseMove(const WindowEventMouseMove&) {}
+        void OnMousePress(const WindowEventMousePress&) {}
+        void OnMouseRelease(const WindowEventMouseRelease&) {}
+        void OnRawMouseMove(const WindowEventRawMouseMove&) {}
+    };
+
     // connect all events in the window to the listener
     void Connect(wdk::Window& window, wdk::WindowListener& listener);
     void Disconnect(wdk::Window& window);
@@ -79,6 +109,8 @@ namespace wdk
     // dispatch a window event to a listener.
     inline void Dispatch(const WindowEventCreate& event, WindowListener& listener)
     { listener.OnCreate(event); }
+    inline void Dispatch(const WindowEventShow& event, WindowListener& listener)
+    { listener.OnShow(event); }
     inline void Dispatch(const WindowEventPaint& event, WindowListener& listener)
     { listener.OnPaint(event); }
     inline void Dispatch(const WindowEventResize& event, WindowListener& listener)
@@ -101,6 +133,8 @@ namespace wdk
     { listener.OnMousePress(event); }
     inline void Dispatch(const WindowEventMouseRelease& event, WindowListener& listener)
     { listener.OnMouseRelease(event); }
+    inline void Dispatch(const WindowEventRawMouseMove& event, WindowListener& listener)
+    { listener.OnRawMouseMove(event); }
 
 } // wdk
 
@@ -0,0 +1,111 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "wdk/types.h"
+
+namespace wdk
+{
+    // A display mode of a monitor. Unlike VideoMode this includes
+    // the refresh rate so the modes that only differ by their
+    // refresh rate can be told apart.
+    struct MonitorMode {
+        // window system identifier of the mode. On X11 this is the
+        // XRandR mode and on Win32 the display settings mode number.
+        std::uintptr_t id = 0;
+        uint_t xres = 0;
+        uint_t yres = 0;
+        // the vertical refresh rate in Hz, for example 59.95.
+        double refresh_rate = 0.0;
+
+        bool IsValid() const
+        {
+            return xres != 0 && yres != 0;
+        }
+    };
+
+    // A monitor (an output on X11) that is connected to the system.
+    struct Monitor {
+        // window system identifier of the monitor. On X11 this is
+        // the XRandR output and on Win32 the display device number.
+        std::uintptr_t id = 0;
+        // the name of the monitor, for example "HDMI-1" or "\\.\DISPLAY1".
+        std::string name;
+        // true for the monitor that the video mode functions
+        // (GetCurrentVideoMode, SetVideoMode) apply to.
+        bool primary = false;
+        // the area of the desktop that the monitor shows.
+        // all zeros when the monitor is turned off.
+        int x = 0;
+        int y = 0;
+        uint_t width  = 0;
+        uint_t height = 0;
+        // the current mode. not valid when the monitor is turned off.
+        MonitorMode current;
+        // the modes that the monitor supports.
+        std::vector<MonitorMode> modes;
+    };
+
+    // Order the modes by their size first and then by their refresh rate.
+    inline bool operator < (const MonitorMode& lhs, const MonitorMode& rhs)
+    {
+        const auto lhs_area = lhs.xres * lhs.yres;
+        const auto rhs_area = rhs.xres * rhs.yres;
+        if (lhs_area != rhs_area)
+            return lhs_area < rhs_area;
+        if (lhs.xres != rhs.xres)
+            return lhs.xres < rhs.xres;
+        return lhs.refresh_rate < rhs.refresh_rate;
+    }
+
+    inline
+    bool operator > (const MonitorMode& lhs, const MonitorMode& rhs)
+    {
+        return (rhs < lhs);
+    }
+
+    inline
+    bool operator == (const MonitorMode& lhs, const MonitorMode& rhs)
+    {
+        return !(lhs < rhs) && !(rhs < lhs);
+    }
+
+    inline
+    bool operator != (const MonitorMode& lhs, const MonitorMode& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    inline
+    std::ostream& operator << (std::ostream& o, const MonitorMode& mode)
+    {
+        o << "MonitorMode: " << mode.xres << "x" << mode.yres << "@" << mode.refresh_rate << "Hz";
+        return o;
+    }
+
+} // wdk
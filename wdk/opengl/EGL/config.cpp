@@ -31,7 +31,7 @@
 #include <vector>
 #include <cassert>
 
-#include "wdk/system.h"
+#include "wdk/display.h"
 #include "wdk/opengl/config.h"
 #include "wdk/opengl/EGL/egldisplay.h"
 
@@ -69,6 +69,7 @@ Config::Attributes Config::DONT_CARE;
 Config::Attributes Config::DEFAULT = GetDefaultAttrs(); 
 
 struct Config::impl {
+    Display*     wdk_display;
     EGLDisplay   display;
     EGLConfig    config;
     uint_t       visualid;
@@ -76,9 +77,13 @@ struct Config::impl {
     bool         srgb;
 };
 
-Config::Config(const Attributes& attrs) : pimpl_(new impl)
+Config::Config(const Attributes& attrs) : Config(Display::GetDefault(), attrs)
+{}
+
+Config::Config(Display& display, const Attributes& attrs) : pimpl_(new impl)
 {
-    pimpl_->display = egl_init(GetNativeDisplayHandle());
+    pimpl_->wdk_display = &display;
+    pimpl_->display = egl_init(display);
 
     std::vector<uint_t> criteria;
 
@@ -158,6 +163,11 @@ Config::~Config()
 {
 }
 
+Display& Config::GetDisplay() const
+{
+    return *pimpl_->wdk_display;
+}
+
 uint_t Config::GetVisualID() const
 {
     return pimpl_->visualid;
@@ -69,7 +69,7 @@ struct Context::impl {
     impl(const wdk::Config& conf, int major_version, int minor_version, bool debug) :
         display(nullptr), surface(nullptr), context(nullptr)
     {
-        display = egl_init(GetNativeDisplayHandle());
+        display = egl_init(conf.GetDisplay());
 
         const EGLint FLAGS = debug ?
             EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR : 0;
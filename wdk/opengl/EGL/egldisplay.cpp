@@ -21,43 +21,75 @@
 //  THE SOFTWARE.
 
 #include <stdexcept>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include "wdk/display.h"
 #include "wdk/opengl/EGL/egldisplay.h"
 
 namespace wdk
 {
 
-EGLDisplay egl_init(native_display_t disp)
+EGLDisplay egl_init(Display& disp)
 {
-    // initialize the EGL display. this is a bit of a hack
-    // and won't work if there ever is more than a single
-    // native display handle. 
-    struct egl 
-    { 
-        EGLDisplay display;
-
-        egl(native_display_t disp)
-        {
+    // initialize the EGL display once for each display and terminate
+    // it when the display is closed. the native handle can be reused
+    // by a display that is opened later so the entry must not outlive
+    // the display. the table is never destroyed since the displays
+    // (such as the default display) can be closed during the static
+    // destruction.
+    struct egl
+    {
+        std::mutex mutex;
+        std::vector<std::pair<native_display_t, EGLDisplay>> displays;
+    };
+    static egl* init = new egl;
+
+    const native_display_t handle = disp.GetNativeHandle();
+
+    std::lock_guard<std::mutex> lock(init->mutex);
+    for (const auto& pair : init->displays)
+    {
+        if (pair.first == handle)
+            return pair.second;
+    }
+
 #if defined(WINDOWS) || defined(_WIN32)
-            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
 #else
-            display = eglGetDisplay(disp);
+    EGLDisplay display = eglGetDisplay(handle);
 #endif
-            if (!display)
-                throw std::runtime_error("eglGetDisplay failed");
+    if (!display)
+        throw std::runtime_error("eglGetDisplay failed");
 
-            EGLint major = 0;
-            EGLint minor = 0;
-            if (!eglInitialize(display, &major, &minor))
-                throw std::runtime_error("eglInitialize failed");
-        }
-       ~egl()
+    EGLint major = 0;
+    EGLint minor = 0;
+    if (!eglInitialize(display, &major, &minor))
+        throw std::runtime_error("eglInitialize failed");
+
+    init->displays.push_back(std::make_pair(handle, display));
+
+    disp.AddCloseHandler([handle]() {
+        std::lock_guard<std::mutex> lock(init->mutex);
+        auto& displays = init->displays;
+        const auto it = std::find_if(displays.begin(), displays.end(),
+            [handle](const std::pair<native_display_t, EGLDisplay>& pair) {
+                return pair.first == handle;
+            });
+        if (it == displays.end())
+            return;
+        const EGLDisplay display = it->second;
+        displays.erase(it);
+
+        // on Win32 every display maps to the same EGL display.
+        for (const auto& pair : displays)
         {
-            eglTerminate(display);
+            if (pair.second == display)
+                return;
         }
-    };
-    static egl init(disp);
-
-    return init.display;
+        eglTerminate(display);
+    });
+    return display;
 }
 
 } // wdk
\ No newline at end of file
@@ -27,6 +27,10 @@
 
 namespace wdk
 {
-    EGLDisplay egl_init(native_display_t disp);
+    class Display;
+
+    // Get the EGL display for the display. It's initialized on first
+    // use and terminated when the display is closed.
+    EGLDisplay egl_init(Display& disp);
 
 } // wdk
\ No newline at end of file
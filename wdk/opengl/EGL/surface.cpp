@@ -54,7 +54,7 @@ struct Surface::impl {
 
 Surface::Surface(const Config& conf, const Window& win) : pimpl_(new impl)
 {
-    pimpl_->display = egl_init(GetNativeDisplayHandle());
+    pimpl_->display = egl_init(conf.GetDisplay());
 
     std::vector<EGLint> attribs;
     if (conf.sRGB())
@@ -71,7 +71,7 @@ Surface::Surface(const Config& conf, const Window& win) : pimpl_(new impl)
 
 Surface::Surface(const Config& conf, const Pixmap& px) : pimpl_(new impl)
 {
-    pimpl_->display = egl_init(GetNativeDisplayHandle());
+    pimpl_->display = egl_init(conf.GetDisplay());
 
     std::vector<EGLint> attribs;
     if (conf.sRGB())
@@ -89,7 +89,7 @@ Surface::Surface(const Config& conf, const Pixmap& px) : pimpl_(new impl)
 
 Surface::Surface(const Config& conf, uint_t width, uint_t height) : pimpl_(new impl)
 {
-    pimpl_->display = egl_init(GetNativeDisplayHandle());
+    pimpl_->display = egl_init(conf.GetDisplay());
 
     std::vector<EGLint> attribs {
         EGL_HEIGHT, (EGLint)height,
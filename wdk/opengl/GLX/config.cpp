@@ -24,7 +24,7 @@
 #include <stdexcept>
 #include <vector>
 
-#include "wdk/system.h"
+#include "wdk/display.h"
 #include "wdk/utility.h"
 #include "wdk/opengl/config.h"
 
@@ -93,6 +93,7 @@ Config::Attributes Config::DONT_CARE = GetDontCareAttrs();
 Config::Attributes Config::DEFAULT   = GetDefaultAttrs();
 
 struct Config::impl {
+    Display*     display;
     GLXFBConfig* configs;
     GLXFBConfig  config;
     uint_t       visualid;
@@ -100,7 +101,10 @@ struct Config::impl {
     bool         srgb;
 };
 
-Config::Config(const Attributes& attrs) : pimpl_(new impl)
+Config::Config(const Attributes& attrs) : Config(Display::GetDefault(), attrs)
+{}
+
+Config::Config(Display& display, const Attributes& attrs) : pimpl_(new impl)
 {
     std::vector<uint_t> criteria = 
     {
@@ -147,7 +151,7 @@ Config::Config(const Attributes& attrs) : pimpl_(new impl)
 
     criteria.push_back(X11_None);
 
-    auto dpy = GetNativeDisplayHandle();
+    auto dpy = display.GetNativeHandle();
 
     int num_matches = 0;
     auto matches = MakeUniqueHandle(glXChooseFBConfig(dpy, DefaultScreen(dpy), (const int*)&criteria[0], &num_matches), XFree);
@@ -168,6 +172,7 @@ Config::Config(const Attributes& attrs) : pimpl_(new impl)
     glXGetFBConfigAttrib(dpy, best, GLX_FBCONFIG_ID, &config_id);
     auto visual = MakeUniqueHandle(glXGetVisualFromFBConfig(dpy, best), XFree);
 
+    pimpl_->display  = &display;
     pimpl_->configs  = matches.release();
     pimpl_->config   = best;
     pimpl_->visualid = visual->visualid;
@@ -181,6 +186,11 @@ Config::~Config()
     XFree(pimpl_->configs);
 }
 
+Display& Config::GetDisplay() const
+{
+    return *pimpl_->display;
+}
+
 uint_t Config::GetVisualID() const
 {
     return pimpl_->visualid;
@@ -27,7 +27,7 @@
 #include <sstream>
 #include <string>
 
-#include "wdk/system.h"
+#include "wdk/display.h"
 #include "wdk/utility.h"
 #include "wdk/X11/errorhandler.h"
 #include "wdk/opengl/context.h"
@@ -73,23 +73,24 @@ namespace wdk
 {
 
 struct Context::impl {
+    ::Display*         display;
     ::Window           temp_window;
     ::GLXWindow        temp_surface;
     ::GLXDrawable      surface; // current surface
     ::GLXContext       context;
 
     impl(const Config& conf, int major_version, int minor_version, bool debug, Context::Type type) :
-        temp_window(0), temp_surface(0), surface(0), context(0)
+        display(nullptr), temp_window(0), temp_surface(0), surface(0), context(0)
     {
         // Context creation requires GLX_ARB_create_context extension.
         // if this is not available at runtime then context creation simply fails.
-        typedef GLXContext (APIENTRY *glXCreateContextAttribsARBProc)(Display*, GLXFBConfig, GLXContext, Bool, const int*);
+        typedef GLXContext (APIENTRY *glXCreateContextAttribsARBProc)(::Display*, GLXFBConfig, GLXContext, Bool, const int*);
 
         auto glXCreateContextAttribs = reinterpret_cast<glXCreateContextAttribsARBProc>(glXGetProcAddress((GLubyte*)"glXCreateContextAttribsARB"));
         if (!glXCreateContextAttribs)
            throw std::runtime_error("cannot create context");
 
-        Display* dpy    = GetNativeDisplayHandle();
+        ::Display* dpy    = conf.GetDisplay().GetNativeHandle();
         GLXFBConfig fbc = conf.GetNativeHandle();
 
         if (type == Context::Type::OpenGL_ES)
@@ -111,9 +112,11 @@ struct Context::impl {
                 throw std::runtime_error("cannot create GL ES context. No GLX_EXT_create_context_es2_profile");
         }
 
-        factory<GLXContext> context_factory(dpy);
+        // the context is checked right away even in a resource batch
+        // since a failure here needs to be reported to the caller.
+        factory<GLXContext> context_factory(dpy, false);
 
-        GLXContext context = context_factory.create([&](Display* dpy)
+        GLXContext context = context_factory.create([&](::Display* dpy)
         {
             const int FLAGS = debug ?
                GLX_CONTEXT_DEBUG_BIT_ARB : 0;
@@ -171,6 +174,7 @@ struct Context::impl {
         if (!glXMakeCurrent(dpy, tmp_surface, context))
             throw std::runtime_error("make current failed");
 
+        this->display      = dpy;
         this->temp_window  = tmp_window;
         this->temp_surface = tmp_surface;
         this->context      = context;
@@ -194,7 +198,7 @@ Context::Context(const Config& conf, int major_version, int minor_version, bool
 
 Context::~Context()
 {
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->display;
 
     glXMakeCurrent(d, X11_None, NULL);
     glXDestroyContext(d, pimpl_->context);
@@ -204,7 +208,7 @@ Context::~Context()
 
 void Context::MakeCurrent(Surface* surf)
 {
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->display;
 
     // glXMakeContextCurrent doesn't like None for surface. (mesa 9.2)
     // so instead of None we use the temporary window surface
@@ -227,14 +231,14 @@ void Context::SwapBuffers()
     if (!pimpl_->surface)
         return;
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->display;
 
     glXSwapBuffers(d, pimpl_->surface);
 }
 
 bool Context::HasDRI() const
 {
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->display;
 
     return (glXIsDirect(d, pimpl_->context) == True);
 }
@@ -245,7 +249,7 @@ bool Context::SetSwapInterval(int interval)
     if (!pimpl_->surface)
         return false;
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->display;
 
     // todo: screen number ??
     const char* extensions_string = glXQueryExtensionsString(d, 0);
@@ -265,7 +269,7 @@ bool Context::SetSwapInterval(int interval)
 
     // Context creation requires GLX_ARB_create_context extension.
     // if this is not available at runtime then context creation simply fails.
-    typedef void (APIENTRY *glXSwapIntervalExtProc)(Display*, GLXDrawable, int);
+    typedef void (APIENTRY *glXSwapIntervalExtProc)(::Display*, GLXDrawable, int);
 
     auto swap_control = reinterpret_cast<glXSwapIntervalExtProc>(glXGetProcAddress((GLubyte*)"glXSwapIntervalEXT"));
     if (!swap_control)
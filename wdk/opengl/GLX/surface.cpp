@@ -26,7 +26,7 @@
 #include <stdexcept>
 
 #include "wdk/X11/errorhandler.h"
-#include "wdk/system.h"
+#include "wdk/display.h"
 #include "wdk/window.h"
 #include "wdk/pixmap.h"
 #include "wdk/opengl/surface.h"
@@ -41,6 +41,7 @@ namespace {
 namespace wdk
 {
 struct Surface::impl {
+    ::Display*   display;
     GLXDrawable  surface;
     surface_type type;
 };
@@ -48,8 +49,9 @@ struct Surface::impl {
 Surface::Surface(const Config& conf, const Window& win)
 {
     pimpl_.reset(new impl);
+    pimpl_->display = conf.GetDisplay().GetNativeHandle();
 
-    factory<GLXDrawable> fac(GetNativeDisplayHandle());
+    factory<GLXDrawable> fac(pimpl_->display);
 
     GLXDrawable surface = fac.create(std::bind(glXCreateWindow, std::placeholders::_1, 
         conf.GetNativeHandle(), win.GetNativeHandle(), nullptr));
@@ -63,8 +65,9 @@ Surface::Surface(const Config& conf, const Window& win)
 Surface::Surface(const Config& conf, const Pixmap& px)
 {
     pimpl_.reset(new impl);
+    pimpl_->display = conf.GetDisplay().GetNativeHandle();
 
-    factory<GLXDrawable> fac(GetNativeDisplayHandle());
+    factory<GLXDrawable> fac(pimpl_->display);
 
     GLXDrawable surface = fac.create(std::bind(glXCreatePixmap, std::placeholders::_1, 
         conf.GetNativeHandle(), px.GetNativeHandle(), nullptr));
@@ -78,8 +81,9 @@ Surface::Surface(const Config& conf, const Pixmap& px)
 Surface::Surface(const Config& conf, uint_t width, uint_t height)
 {
     pimpl_.reset(new impl);
+    pimpl_->display = conf.GetDisplay().GetNativeHandle();
 
-    factory<GLXDrawable> fac(GetNativeDisplayHandle());
+    factory<GLXDrawable> fac(pimpl_->display);
 
     const int attrs[] = {
         GLX_PBUFFER_WIDTH, (int)width,
@@ -102,7 +106,7 @@ Surface::~Surface()
 
 uint_t Surface::GetWidth() const
 {
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->display;
 
     uint_t width = 0;
 
@@ -113,7 +117,7 @@ uint_t Surface::GetWidth() const
 
 uint_t Surface::GetHeight() const
 {
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->display;
 
     uint_t height = 0;
 
@@ -132,7 +136,7 @@ void Surface::Dispose()
     if (!pimpl_->surface)
         return;
 
-    Display* d = GetNativeDisplayHandle();
+    ::Display* d = pimpl_->display;
 
     switch (pimpl_->type)
     {
@@ -25,6 +25,7 @@
 #include <vector>
 #include <cassert>
 #include "wdk/utility.h"
+#include "wdk/display.h"
 #include "wdk/opengl/config.h"
 #include "wdk/opengl/context.h"
 #include "wdk/opengl/WGL/fakecontext.h"
@@ -167,14 +168,22 @@ Config::Attributes Config::DONT_CARE = GetDontCareAttrs();
 Config::Attributes Config::DEFAULT   = GetDefaultAttrs();
 
 struct Config::impl {
+    Display* display;
     PIXELFORMATDESCRIPTOR desc;
     bool srgb;
     std::shared_ptr<wgl::FakeContext> fake;
     int format;
 };
 
-Config::Config(const Attributes& attrs) : pimpl_(new impl)
+Config::Config(const Attributes& attrs) : Config(Display::GetDefault(), attrs)
+{}
+
+Config::Config(Display& display, const Attributes& attrs) : pimpl_(new impl)
 {
+    // the pixel format is selected on a window of our own
+    // so there's nothing to do with the display here.
+    pimpl_->display = &display;
+
     // there doesn't seem to be a "GLX_DONT_CARE" counterpart for
     // WGL so in case the sRGB or double buffer setting isn't set
     // we're going to make a decision here. The client doesn't care
@@ -255,6 +264,11 @@ Config::~Config()
 {
 }
 
+Display& Config::GetDisplay() const
+{
+    return *pimpl_->display;
+}
+
 uint_t Config::GetVisualID() const
 {
     return pimpl_->format;
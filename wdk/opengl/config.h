@@ -35,6 +35,8 @@
 
 namespace wdk
 {
+    class Display;
+
     class TriBool
     {
     public:
@@ -173,8 +175,15 @@ namespace wdk
         // create new config with the given attributes.
         // throws an exception if no such configuration is available.
         Config(const Attributes& attrs = Config::DEFAULT);
+        // create new config with the given attributes on the given display.
+        // The contexts and surfaces created with the config use the same
+        // display. The display must outlive the config.
+        Config(Display& display, const Attributes& attrs = Config::DEFAULT);
        ~Config();
 
+        // Get the display the config was created on.
+        Display& GetDisplay() const;
+
         // Get the visualid that is used to identify compatible items.
         // The visual ID can then be used to create other compatible
         // objects such as Windows.
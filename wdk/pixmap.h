@@ -28,6 +28,8 @@
 
 namespace wdk
 {
+    class Display;
+
     // Window system provided bitmap
     class Pixmap
     {
@@ -35,6 +37,9 @@ namespace wdk
         // Create a new bitmap with the given width, height
         // and visual id. 
         Pixmap(uint_t width, uint_t height, uint_t visualid);
+        // Create a new bitmap on the given display. The display
+        // must outlive the pixmap.
+        Pixmap(Display& display, uint_t width, uint_t height, uint_t visualid);
        ~Pixmap();
         // Get the pixmap's platform specific native handle.
         // On X11 this is Pixmap, on Win32 this is HBITMAP
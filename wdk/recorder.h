@@ -0,0 +1,105 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <cstddef>
+
+#include "wdk/types.h"
+
+namespace wdk
+{
+    // Record the events read from the event queue into a binary file
+    // for later replay with EventPlayer. The events are stored with
+    // their timestamps so that they can be replayed in real time.
+    // Note that this is currently only available on X11.
+    class EventRecorder
+    {
+    public:
+        // Create a new recording in the given file. If the file
+        // exists it's overwritten. Throws std::runtime_error if
+        // the file can't be opened.
+        EventRecorder(const std::string& file);
+       ~EventRecorder();
+
+        // Append the event to the recording.
+        void Record(const native_event_t& ev);
+
+        // Flush the recorded events to the file.
+        void Flush();
+
+        // Get the number of events recorded so far.
+        std::size_t GetEventCount() const;
+    private:
+        struct impl;
+        std::unique_ptr<impl> pimpl_;
+    };
+
+    // Play back events recorded with EventRecorder. The recording is memory
+    // mapped and the events are re-created as native events that can be
+    // passed to the normal dispatch path (Window::ProcessEvent, EventDispatcher)
+    // just like the events read with PeekEvent/WaitEvent.
+    // Each event's timestamp (native_event_t::get_timestamp) is the start of
+    // the playback plus the event's recorded offset from the first event.
+    // Note that this is currently only available on X11.
+    class EventPlayer
+    {
+    public:
+        enum class Timing {
+            // deliver the events as fast as they're asked for.
+            AsFastAsPossible,
+            // deliver the events with the same relative timing as they were recorded.
+            RealTime
+        };
+
+        // Open the recording in the given file. Throws std::runtime_error
+        // if the file can't be opened or is not a valid recording.
+        EventPlayer(const std::string& file);
+       ~EventPlayer();
+
+        // Set the window where the recorded window events are directed to.
+        // If the recording has events for multiple windows they're all directed
+        // to this window. If no window is set the events keep the original window
+        // handles which are unlikely to match any existing window.
+        void SetWindow(native_window_t window);
+
+        // Set the playback timing. The default is AsFastAsPossible.
+        void SetTiming(Timing timing);
+
+        // Get the next event from the recording. In real time mode this will
+        // block until it's time to deliver the event.
+        // Returns false when all the events have been played back.
+        bool NextEvent(native_event_t& ev);
+
+        // Restart the playback from the first event.
+        void Rewind();
+
+        // Get the total number of events in the recording.
+        std::size_t GetEventCount() const;
+    private:
+        struct impl;
+        std::unique_ptr<impl> pimpl_;
+    };
+
+} // wdk
@@ -0,0 +1,76 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#pragma once
+
+#include "wdk/system.h"
+
+namespace wdk
+{
+    // RAII type for a batch of resource creations.
+    // See BeginResourceBatch and EndResourceBatch.
+    //
+    // wdk::ResourceBatch batch;
+    // window_a.Create(...);
+    // window_b.Create(...);
+    // batch.Commit(); // throws if any of the creations failed
+    //
+    // If the batch is not committed it's ended when the object
+    // is destroyed and any errors are ignored.
+    class ResourceBatch
+    {
+    public:
+        // Open a batch on the default display.
+        ResourceBatch() : ResourceBatch(Display::GetDefault())
+        {}
+        // Open a batch on the given display.
+        ResourceBatch(Display& display) : mDisplay(display)
+        {
+            wdk::BeginResourceBatch(mDisplay);
+        }
+       ~ResourceBatch()
+        {
+            if (mOpen)
+            {
+                try
+                {
+                    wdk::EndResourceBatch(mDisplay);
+                }
+                catch (...)
+                {}
+            }
+        }
+        // End the batch and check for errors. Throws std::runtime_error
+        // if any of the creations in the batch failed.
+        void Commit()
+        {
+            mOpen = false;
+            wdk::EndResourceBatch(mDisplay);
+        }
+        ResourceBatch(const ResourceBatch&) = delete;
+        ResourceBatch& operator=(const ResourceBatch&) = delete;
+    private:
+        Display& mDisplay;
+        bool mOpen = true;
+    };
+
+} // wdk
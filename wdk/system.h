@@ -24,14 +24,19 @@
 
 #include <vector>
 #include <string>
+#include <cstddef>
+#include <cstdint>
 
 #include "wdk/keys.h"
 #include "wdk/types.h"
 #include "wdk/bitflag.h"
+#include "wdk/display.h"
 
 namespace wdk
 {
     struct VideoMode;
+    struct Monitor;
+    struct MonitorMode;
     enum class Keymod;
     enum class Keysym;
 
@@ -41,7 +46,12 @@ namespace wdk
     // You should not mess with this unless you know what you're doing.
     native_display_t GetNativeDisplayHandle();
 
+    // Get the setup timings of the default display.
+    DisplayTimings GetDisplayTimings();
+
      // Get the current videomode setting.
+    // Note that on X11 the system_resolution_change notifications are
+    // enabled by the first call to any of the video mode functions.
     VideoMode GetCurrentVideoMode();
 
     // Request the system to change the current display video mode. 
@@ -53,6 +63,20 @@ namespace wdk
     // Get a list of available video modes.
     std::vector<VideoMode> ListVideoModes();
 
+    // Get a list of the monitors that are connected to the system
+    // with their geometry, current mode and the modes they support.
+    // On X11 this requires XRandR 1.2 and throws std::runtime_error
+    // if it's not available.
+    std::vector<Monitor> ListMonitors();
+
+    // Change the mode of a monitor. The mode must be one of the modes
+    // that ListMonitors returned for the monitor and the monitor must be
+    // turned on. Unlike SetVideoMode this sets the refresh rate too and
+    // only affects the given monitor. The monitor stays where it is on
+    // the desktop, the other monitors are not moved to make room.
+    // If the change is rejected an exception is thrown.
+    void SetMonitorMode(const Monitor& monitor, const MonitorMode& mode);
+
     // Get the next application event from the queue if any. 
     // returns true if event was available and assignes the
     // event into ev. Otherwise returns false and no event 
@@ -64,6 +88,122 @@ namespace wdk
     // Will block until an event is posted. 
     void WaitEvent(native_event_t& ev);
 
+    // Get the next application event from the event queue.
+    // Will block until an event is posted or until the timeout expires.
+    // Returns true if an event was available otherwise false on timeout.
+    // A timeout of NO_TIMEOUT blocks forever and a timeout of 0 doesn't block.
+    bool WaitEvent(native_event_t& ev, ms_t timeout);
+
+    // Get up to max application events from the event queue without blocking.
+    // The events are stored in the out array and the number of events
+    // is returned. If no events were immediately available returns 0.
+    // This is more efficient than calling PeekEvent repeatedly when there's
+    // a backlog of events since the queue is only checked once.
+    // Note that on X11 this will not flush the output buffer.
+    std::size_t PeekEvents(native_event_t* out, std::size_t max);
+
+    // Get up to max application events from the event queue.
+    // Will block until at least one event is available and then
+    // returns that event and any other events that were already
+    // available. Returns the number of events stored in out.
+    std::size_t WaitEvents(native_event_t* out, std::size_t max);
+
+    // Get the next event from the given display's event queue if any.
+    // For the default display this is the same as PeekEvent(ev). For any
+    // other display only the window system events of that display are
+    // returned, the user events and the input thread are only available
+    // on the default display.
+    bool PeekEvent(Display& display, native_event_t& ev);
+
+    // Get the next event from the given display's event queue.
+    // Will block until an event is available or until the timeout expires.
+    // Returns true if an event was available otherwise false on timeout.
+    // See PeekEvent(Display&, native_event_t&) about the events.
+    bool WaitEvent(Display& display, native_event_t& ev, ms_t timeout);
+
+    // Post a user event with the given payload to the application's event queue.
+    // This is safe to call from any thread and will wake up a thread that
+    // is blocked in WaitEvent. The event is returned from PeekEvent/WaitEvent
+    // with the identity native_event_t::type::user and the payload can be
+    // read with GetUserEventPayload. On Win32 the user events go to the first
+    // thread that calls PeekEvent/WaitEvent and the events posted before
+    // that are held until then.
+    // Returns false if the event could not be posted because the queue is full.
+    bool PostUserEvent(std::uintptr_t payload);
+
+    // Get the payload of a user event posted with PostUserEvent.
+    std::uintptr_t GetUserEventPayload(const native_event_t& ev);
+
+    // Start a dedicated input thread. The input thread opens its own
+    // display connection and reads the keyboard and mouse input events
+    // for windows created on the default display after this call as soon
+    // as they arrive and timestamps them (see native_event_t::get_timestamp).
+    // The events are then returned from PeekEvent/WaitEvent after the events
+    // that are already waiting on the application's connection so that the
+    // input doesn't pass a focus, configure or expose event that was sent
+    // before it. Once started the thread runs until the application exits.
+    // On Win32 this has no effect since the window input is always
+    // delivered to the thread that created the window.
+    void StartInputThread();
+
+    // Bind the window to the calling thread. The events of a bound window
+    // are then only returned from PeekThreadEvent/WaitThreadEvent on that
+    // thread so each thread can service its own windows in parallel.
+    // The first call starts a router thread that becomes the only reader
+    // of the default display's connection. It sorts the events into the
+    // bound threads' queues by their window and leaves the rest for
+    // PeekEvent/WaitEvent. Once started the router runs until the
+    // application exits. Note that while it's running Window::Create
+    // doesn't wait for the window to become visible, wait for OnShow
+    // instead, and the events of the bound windows are not tracked in
+    // the input snapshot. A thread that falls behind doesn't hold up the
+    // router or the other threads, its events are buffered until it
+    // reads them.
+    // Only windows on the default display can be bound.
+    // On Win32 the window messages already go to the thread that created
+    // the window, so the window must be created on the thread it's bound
+    // to and this has no other effect.
+    void SetWindowThreadAffinity(native_window_t window);
+
+    // Unbind the window from its thread. Its events that are still
+    // in the thread's queue stay there. Window::Destroy does this.
+    void ClearWindowThreadAffinity(native_window_t window);
+
+    // Get the next event for the windows bound to the calling thread if any.
+    bool PeekThreadEvent(native_event_t& ev);
+
+    // Get the next event for the windows bound to the calling thread.
+    // Will block until an event is available or until the timeout expires.
+    // Returns true if an event was available otherwise false on timeout.
+    // The thread only waits on its own queue.
+    bool WaitThreadEvent(native_event_t& ev, ms_t timeout);
+
+    // Enable or disable coalescing of mouse motion events in the event queue.
+    // When enabled a run of consecutive mouse motion events for the same
+    // window is collapsed into the latest one. Any other event (such as
+    // a mouse button or a keyboard key press) in between ends the run.
+    // The number of raw motion events that were collapsed is available in
+    // WindowEventMouseMove::samples. Off by default.
+    // Note that Win32 already coalesces mouse moves so this has no effect there.
+    void SetMouseMoveCoalescing(bool on);
+
+    // Begin a batch of resource creations. While the batch is open creating
+    // windows, pixmaps and GL surfaces doesn't wait for the window system to
+    // validate each creation separately. Instead all of them are validated
+    // with a single round trip by EndResourceBatch. Batches can't be nested.
+    // See ResourceBatch in wdk/resourcebatch.h for a scoped batch.
+    // On Win32 the creation is always synchronous and this has no effect.
+    void BeginResourceBatch();
+
+    // End the current batch of resource creations and check for errors.
+    // Throws std::runtime_error if any of the creations in the batch failed.
+    void EndResourceBatch();
+
+    // Begin and end a batch of resource creations on the given display.
+    // Each display can have its own batch open at the same time.
+    void BeginResourceBatch(Display& display);
+    void EndResourceBatch(Display& display);
+
     // Event translation.
 
     // Translate system keydown event to key modifier and key symbol.
@@ -74,6 +214,8 @@ namespace wdk
 
     // Test if the keyboard key identified by 'symbol' is currently down.
     // Returns true if down, otherwise false.
+    // Note that this queries the window system every time. For testing
+    // many keys once per frame see GetInputSnapshot in wdk/input.h
     bool TestKeyDown(Keysym symbol);
 
     // Test if the keyboard key identified by the native keycode is 
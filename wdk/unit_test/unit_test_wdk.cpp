@@ -23,19 +23,51 @@
 #include <algorithm>
 #include <iostream>
 #include <iterator>
+#include <vector>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <new>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #include "wdk/system.h"
 #include "wdk/videomode.h"
+#include "wdk/monitor.h"
 #include "wdk/modechange.h"
 #include "wdk/window.h"
 #include "wdk/events.h"
 #include "wdk/listener.h"
+#include "wdk/dispatcher.h"
+#include "wdk/resourcebatch.h"
+#include "wdk/input.h"
+#if !defined(_WIN32)
+#  include <X11/Xlib.h>
+#  include <X11/keysym.h>
+#  include "wdk/recorder.h"
+#  include "wdk/X11/errorhandler.h"
+#  include "wdk/X11/eventqueue.h"
+#endif
 
 #include "test_minimal.h"
 
+// count the dynamic memory allocations done through the global operator new
+// so that we can check that some code paths don't allocate at all.
+std::atomic<std::size_t> allocation_count;
+
+void* operator new(std::size_t size)
+{
+    ++allocation_count;
+    if (void* ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
 bool WaitVideoModeChange()
 {
     // pump the application message loop for a while expecting to
@@ -72,6 +104,133 @@ void ProcessWindowEvents(wdk::Window& win, unsigned secs)
         win.ProcessEvent(event);
 }
 
+void unit_test_event_callback()
+{
+    struct Event {
+        int value = 0;
+    };
+
+    int sum = 0;
+    wdk::EventCallback<Event> callback;
+    TEST_REQUIRE(!callback);
+
+    // bind more handlers than there are inline slots.
+    wdk::Subscription subs[5];
+    for (int i=0; i<5; ++i)
+        subs[i] = callback.Bind([&sum, i](const Event& e) { sum += e.value * (i + 1); });
+    TEST_REQUIRE(callback);
+    TEST_REQUIRE(callback.GetHandlerCount() == 5);
+
+    callback(Event{1});
+    TEST_REQUIRE(sum == 1+2+3+4+5);
+
+    sum = 0;
+    TEST_REQUIRE(callback.Unbind(subs[1]));
+    TEST_REQUIRE(callback.Unbind(subs[3]));
+    TEST_REQUIRE(!callback.Unbind(subs[3]));
+    callback(Event{1});
+    TEST_REQUIRE(sum == 1+3+5);
+
+    // a stale handle doesn't unbind the handler that reused the slot.
+    const auto sub = callback.Bind([&sum](const Event& e) { sum += e.value * 100; });
+    TEST_REQUIRE(sub.index == subs[3].index || sub.index == subs[1].index);
+    TEST_REQUIRE(!callback.Unbind(subs[1]));
+    TEST_REQUIRE(!callback.Unbind(subs[3]));
+    sum = 0;
+    callback(Event{1});
+    TEST_REQUIRE(sum == 1+3+5+100);
+
+    // handler unbinding itself and binding a new handler during dispatch.
+    sum = 0;
+    wdk::Subscription self;
+    self = callback.Bind([&](const Event& e) {
+        TEST_REQUIRE(callback.Unbind(self));
+        TEST_REQUIRE(callback.Unbind(sub));
+        callback.Bind([&sum](const Event& e) { sum += e.value * 1000; });
+    });
+    callback(Event{1});
+    TEST_REQUIRE(sum == 1+3+5);
+    sum = 0;
+    callback(Event{1});
+    TEST_REQUIRE(sum == 1+3+5+1000);
+
+    // a handler bound during dispatch into a reused free slot
+    // isn't called by the same dispatch either.
+    callback.Clear();
+    callback.Bind([&sum](const Event& e) { sum += e.value; });
+    const auto freed = callback.Bind([](const Event&) {});
+    TEST_REQUIRE(callback.Unbind(freed));
+    callback.Bind([&](const Event&) {
+        callback.Bind([&sum](const Event& e) { sum += e.value * 10; });
+    });
+    sum = 0;
+    callback(Event{1});
+    TEST_REQUIRE(sum == 1);
+    sum = 0;
+    callback(Event{1});
+    TEST_REQUIRE(sum == 1+10);
+
+    // binding and unbinding in a handler reuses the slots
+    // instead of growing the storage on every invocation.
+    {
+        wdk::EventCallback<Event> churn;
+        std::uint32_t max_index = 0;
+        churn.Bind([&](const Event&) {
+            for (int i=0; i<100; ++i)
+            {
+                const auto temp = churn.Bind([&sum](const Event& e) { sum += e.value; });
+                max_index = std::max(max_index, temp.index);
+                TEST_REQUIRE(churn.Unbind(temp));
+            }
+        });
+        sum = 0;
+        for (int i=0; i<100; ++i)
+            churn(Event{1});
+        TEST_REQUIRE(sum == 0);
+        TEST_REQUIRE(max_index == 1);
+        TEST_REQUIRE(churn.GetHandlerCount() == 1);
+        TEST_REQUIRE(churn.Bind([](const Event&) {}).index == 1);
+    }
+
+    // a throwing handler doesn't leave the callback in the
+    // invoking state, an unbound slot is released right away.
+    callback.Clear();
+    callback.Bind([](const Event&) { throw std::runtime_error("handler"); });
+    try
+    {
+        callback(Event{1});
+        TEST_REQUIRE(!"exception expected");
+    }
+    catch (const std::runtime_error&)
+    {}
+    const auto released = callback.Bind([](const Event&) {});
+    TEST_REQUIRE(callback.Unbind(released));
+    TEST_REQUIRE(callback.Bind([](const Event&) {}).index == released.index);
+
+    callback.Clear();
+    TEST_REQUIRE(!callback);
+    sum = 0;
+    callback(Event{1});
+    TEST_REQUIRE(sum == 0);
+}
+
+void unit_test_display_timings()
+{
+    wdk::GetNativeDisplayHandle();
+
+    auto timings = wdk::GetDisplayTimings();
+#if !defined(_WIN32)
+    TEST_REQUIRE(timings.open.count());
+    // set up only when first needed.
+    TEST_REQUIRE(timings.keyboard.count() == 0);
+    TEST_REQUIRE(timings.randr.count() == 0);
+
+    wdk::GetCurrentVideoMode();
+    timings = wdk::GetDisplayTimings();
+    TEST_REQUIRE(timings.randr.count());
+#endif
+}
+
 void unit_test_video_modes()
 {
     // test enumerating supported video modes and setting the mode.
@@ -88,6 +247,9 @@ void unit_test_video_modes()
                 continue;
 
             wdk::SetVideoMode(m);
+            // the cached screen state must not be stale after a change.
+            const auto& current = wdk::GetCurrentVideoMode();
+            TEST_REQUIRE(current.xres == m.xres && current.yres == m.yres);
             TEST_REQUIRE(WaitVideoModeChange());
         }
         // restore to original mode.
@@ -123,6 +285,48 @@ void unit_test_video_modes()
     }
 }
 
+void unit_test_monitors()
+{
+    const auto& monitors = wdk::ListMonitors();
+    TEST_REQUIRE(!monitors.empty());
+    TEST_REQUIRE(std::count_if(monitors.begin(), monitors.end(),
+        [](const wdk::Monitor& m) { return m.primary; }) == 1);
+
+    for (const auto& monitor : monitors)
+    {
+        TEST_REQUIRE(!monitor.name.empty());
+        TEST_REQUIRE(!monitor.modes.empty());
+        if (!monitor.current.IsValid())
+            continue;
+        TEST_REQUIRE(monitor.current.refresh_rate > 0.0);
+        TEST_REQUIRE(monitor.width == monitor.current.xres);
+        TEST_REQUIRE(monitor.height == monitor.current.yres);
+    }
+
+    // change the refresh rate of the primary monitor and check that
+    // the modes with the same size but another rate can be told apart.
+    const auto primary = *std::find_if(monitors.begin(), monitors.end(),
+        [](const wdk::Monitor& m) { return m.primary; });
+    const auto original = primary.current;
+    for (const auto& mode : primary.modes)
+    {
+        if (mode.xres != original.xres || mode.yres != original.yres || mode == original)
+            continue;
+
+        TEST_REQUIRE(mode != original);
+        wdk::SetMonitorMode(primary, mode);
+        for (const auto& monitor : wdk::ListMonitors())
+        {
+            if (monitor.id == primary.id)
+                TEST_REQUIRE(monitor.current.id == mode.id);
+        }
+        // the screen size doesn't change so the notification is optional.
+        WaitVideoModeChange();
+    }
+    if (original.IsValid())
+        wdk::SetMonitorMode(primary, original);
+}
+
 void unit_test_keyboard()
 {
     for (int i = (int)wdk::Keysym::Backspace; i <= (int)wdk::Keysym::Escape; ++i)
@@ -299,6 +503,231 @@ void unit_test_window_functions()
     }
 }
 
+// test that the combined geometry matches the individual getters
+// and follows the window changes.
+void unit_test_window_geometry()
+{
+    wdk::Window w;
+    w.Create("unit-test", 200, 100, 0);
+    ProcessWindowEvents(w, 1);
+
+    auto geom = w.GetGeometry();
+    TEST_REQUIRE(geom.width == 200);
+    TEST_REQUIRE(geom.height == 100);
+    TEST_REQUIRE(geom.x == w.GetPosX());
+    TEST_REQUIRE(geom.y == w.GetPosY());
+
+    w.Move(geom.x + 50, geom.y + 50);
+    w.SetSize(300, 200);
+    ProcessWindowEvents(w, 1);
+
+    const auto moved = w.GetGeometry();
+    TEST_REQUIRE(moved.x == geom.x + 50);
+    TEST_REQUIRE(moved.y == geom.y + 50);
+    TEST_REQUIRE(moved.width == 300);
+    TEST_REQUIRE(moved.height == 200);
+    TEST_REQUIRE(w.GetSurfaceWidth() == 300);
+    TEST_REQUIRE(w.GetSurfaceHeight() == 200);
+
+    w.Destroy();
+}
+
+// test that the event objects and pumping the event queue
+// don't do dynamic memory allocations.
+void unit_test_event_allocations()
+{
+    // constructing, copying and moving events.
+    {
+        const std::size_t before = allocation_count;
+
+        wdk::native_event_t a;
+        wdk::native_event_t b(a);
+        wdk::native_event_t c;
+        c = b;
+        c = std::move(a);
+        TEST_REQUIRE(allocation_count == before);
+    }
+
+    wdk::Window w;
+    w.Create("window", 400, 400, 0);
+    ProcessWindowEvents(w, 1);
+
+    // generate some events and then pump them out of the queue.
+    w.SetSize(300, 300);
+    w.Invalidate();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    unsigned events = 0;
+    wdk::native_event_t event;
+    for (;;)
+    {
+        const std::size_t before = allocation_count;
+        const bool got_event = wdk::PeekEvent(event);
+        TEST_REQUIRE(allocation_count == before);
+        if (!got_event)
+            break;
+        ++events;
+    }
+    TEST_REQUIRE(events);
+}
+
+// test draining the event queue in batches.
+void unit_test_batch_events()
+{
+    bool got_paint = false;
+
+    wdk::Window w;
+    w.OnPaint = [&](const wdk::WindowEventPaint&) {
+        got_paint = true;
+    };
+    w.Create("window", 400, 400, 0);
+    w.SetSize(300, 300);
+    w.Invalidate();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    wdk::native_event_t events[4];
+    unsigned total = 0;
+    for (;;)
+    {
+        const auto count = wdk::PeekEvents(events, 4);
+        TEST_REQUIRE(count <= 4);
+        if (!count)
+            break;
+        for (std::size_t i=0; i<count; ++i)
+            w.ProcessEvent(events[i]);
+        total += count;
+    }
+    TEST_REQUIRE(total);
+    TEST_REQUIRE(got_paint);
+
+    // should not block since there's an event coming.
+    w.Invalidate();
+    const auto count = wdk::WaitEvents(events, 4);
+    TEST_REQUIRE(count >= 1 && count <= 4);
+}
+
+// test waiting for events with a timeout.
+void unit_test_wait_event_timeout()
+{
+    wdk::Window w;
+    w.Create("window", 400, 400, 0);
+    ProcessWindowEvents(w, 1);
+
+    wdk::native_event_t event;
+
+    const auto start = std::chrono::steady_clock::now();
+    TEST_REQUIRE(wdk::WaitEvent(event, 100) == false);
+    const auto end = std::chrono::steady_clock::now();
+    TEST_REQUIRE(end - start >= std::chrono::milliseconds(100));
+
+    TEST_REQUIRE(wdk::WaitEvent(event, 0) == false);
+
+    w.Invalidate();
+    TEST_REQUIRE(wdk::WaitEvent(event, 1000) == true);
+}
+
+// test posting user events from another thread.
+void unit_test_user_events()
+{
+    std::thread poster([]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        for (std::uintptr_t i=1; i<=3; ++i)
+            TEST_REQUIRE(wdk::PostUserEvent(i));
+    });
+
+    std::uintptr_t expected = 1;
+    while (expected <= 3)
+    {
+        wdk::native_event_t event;
+        TEST_REQUIRE(wdk::WaitEvent(event, 5000));
+        if (event.identity() != wdk::native_event_t::type::user)
+            continue;
+        TEST_REQUIRE(wdk::GetUserEventPayload(event) == expected);
+        ++expected;
+    }
+    poster.join();
+}
+
+#if !defined(_WIN32)
+// test that recorded window events are replayed into another window.
+void unit_test_event_replay()
+{
+    unsigned recorded_paints = 0;
+    unsigned replayed_paints = 0;
+    // offsets of the recorded events from the first event.
+    std::vector<std::chrono::steady_clock::duration> recorded_times;
+
+    {
+        wdk::EventRecorder recorder("wdk_events.bin");
+        std::chrono::steady_clock::time_point start;
+
+        wdk::Window w;
+        w.OnPaint = [&](const wdk::WindowEventPaint&) {
+            ++recorded_paints;
+        };
+        w.Create("window", 600, 500, 0);
+        w.Invalidate();
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        wdk::native_event_t event;
+        while (wdk::PeekEvent(event))
+        {
+            if (recorded_times.empty())
+                start = event.get_timestamp();
+            recorded_times.push_back(event.get_timestamp() - start);
+            recorder.Record(event);
+            w.ProcessEvent(event);
+        }
+        TEST_REQUIRE(recorder.GetEventCount());
+        w.Destroy();
+    }
+    TEST_REQUIRE(recorded_paints);
+
+    wdk::Window w;
+    w.Create("window", 600, 500, 0);
+    ProcessWindowEvents(w, 1);
+    w.OnPaint = [&](const wdk::WindowEventPaint&) {
+        ++replayed_paints;
+    };
+
+    wdk::EventPlayer player("wdk_events.bin");
+    player.SetWindow(w.GetNativeHandle());
+
+    // the events are stamped with their recorded offsets.
+    std::chrono::steady_clock::time_point start;
+    std::size_t index = 0;
+    wdk::native_event_t event;
+    while (player.NextEvent(event))
+    {
+        if (index == 0)
+            start = event.get_timestamp();
+        TEST_REQUIRE(event.get_timestamp() - start == recorded_times[index++]);
+        w.ProcessEvent(event);
+    }
+    TEST_REQUIRE(index == recorded_times.size());
+    TEST_REQUIRE(replayed_paints == recorded_paints);
+
+    // play back again from the start in real time. the events
+    // are not delivered before their offset has passed.
+    replayed_paints = 0;
+    index = 0;
+    player.Rewind();
+    player.SetTiming(wdk::EventPlayer::Timing::RealTime);
+    while (player.NextEvent(event))
+    {
+        if (index == 0)
+            start = event.get_timestamp();
+        TEST_REQUIRE(event.get_timestamp() - start == recorded_times[index++]);
+        TEST_REQUIRE(std::chrono::steady_clock::now() >= event.get_timestamp());
+        w.ProcessEvent(event);
+    }
+    TEST_REQUIRE(replayed_paints == recorded_paints);
+
+    w.Destroy();
+    std::remove("wdk_events.bin");
+}
+#endif
+
 // test window create event.
 // We should get create event when:
 // - window is created.
@@ -327,6 +756,161 @@ void unit_test_window_create_event()
     TEST_REQUIRE(got_create_event == true);
 }
 
+// test creating a window without waiting for it to become visible.
+void unit_test_window_create_nowait()
+{
+    bool shown = false;
+
+    wdk::Window w;
+    w.OnShow = [&](const wdk::WindowEventShow&) {
+        shown = true;
+    };
+    w.SetCreateTimeout(0);
+    w.Create("window", 200, 200, 0);
+
+    const auto start = std::chrono::steady_clock::now();
+    while (!shown && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+    {
+        wdk::native_event_t event;
+        if (wdk::WaitEvent(event, 100))
+            w.ProcessEvent(event);
+    }
+    TEST_REQUIRE(shown);
+
+    w.Destroy();
+}
+
+// test creating several windows in one batch.
+void unit_test_resource_batch()
+{
+    wdk::Window windows[3];
+    {
+        wdk::ResourceBatch batch;
+        for (auto& w : windows)
+        {
+            w.SetCreateTimeout(0);
+            w.Create("window", 100, 100, 0);
+        }
+        batch.Commit();
+    }
+    for (auto& w : windows)
+    {
+        TEST_REQUIRE(w.DoesExist());
+        w.Destroy();
+    }
+}
+
+#if !defined(_WIN32)
+// test that a failed creation in a batch makes the commit throw and
+// that a batch only has the requests of the thread that opened it.
+void unit_test_resource_batch_error()
+{
+    ::Display* d = wdk::GetNativeDisplayHandle();
+    const ::Window root = DefaultRootWindow(d);
+
+    wdk::ResourceBatch batch;
+
+    // there's no pixmap format with depth 3.
+    wdk::factory<::Pixmap> bad(d);
+    bad.create([=](::Display* dpy) {
+        return XCreatePixmap(dpy, root, 16, 16, 3);
+    });
+    // the error is only checked when the batch is committed.
+    TEST_REQUIRE(!bad.has_error());
+
+    // another thread's batch on the same display doesn't see the error.
+    bool other_ok = false;
+    std::thread other([&]() {
+        wdk::ResourceBatch batch;
+        wdk::factory<::Pixmap> good(d);
+        const ::Pixmap px = good.create([=](::Display* dpy) {
+            return XCreatePixmap(dpy, root, 16, 16, DefaultDepth(dpy, DefaultScreen(dpy)));
+        });
+        batch.Commit();
+        XFreePixmap(d, px);
+        other_ok = true;
+    });
+    other.join();
+    TEST_REQUIRE(other_ok);
+
+    try
+    {
+        batch.Commit();
+        TEST_REQUIRE(!"exception expected");
+    }
+    catch (const std::runtime_error&)
+    {}
+}
+#endif
+
+void unit_test_display_threads()
+{
+    // each thread creates a window on its own display and processes
+    // its events without touching the default display.
+    std::atomic<unsigned> painted {0};
+
+    auto thread_main = [&]() {
+        wdk::Display display;
+        wdk::Window w(display);
+        bool paint = false;
+        w.OnPaint = [&](const wdk::WindowEventPaint&) {
+            paint = true;
+        };
+        w.Create("display thread", 200, 200, 0);
+
+        const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        wdk::native_event_t event;
+        while (!paint && std::chrono::steady_clock::now() < end)
+        {
+            if (wdk::WaitEvent(display, event, 100))
+                w.ProcessEvent(event);
+        }
+        if (paint)
+            ++painted;
+    };
+    std::thread a(thread_main);
+    std::thread b(thread_main);
+    a.join();
+    b.join();
+    TEST_REQUIRE(painted == 2);
+}
+
+// test that the events of windows bound to different threads are
+// delivered to those threads. once started the event router keeps
+// running so this must be the last test using the default display.
+void unit_test_window_thread_affinity()
+{
+    std::atomic<unsigned> painted {0};
+
+    auto thread_main = [&]() {
+        wdk::Window w;
+        bool paint = false;
+        w.OnPaint = [&](const wdk::WindowEventPaint&) {
+            paint = true;
+        };
+        w.Create("thread affinity", 200, 200, 0);
+        wdk::SetWindowThreadAffinity(w.GetNativeHandle());
+        w.Invalidate();
+
+        const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        wdk::native_event_t event;
+        while (!paint && std::chrono::steady_clock::now() < end)
+        {
+            if (!wdk::WaitThreadEvent(event, 100))
+                continue;
+            TEST_REQUIRE(event.get_window_handle() == w.GetNativeHandle());
+            w.ProcessEvent(event);
+        }
+        if (paint)
+            ++painted;
+    };
+    std::thread a(thread_main);
+    std::thread b(thread_main);
+    a.join();
+    b.join();
+    TEST_REQUIRE(painted == 2);
+}
+
 // test paint event.
 //
 // this specific event and it's invalid region parameters
@@ -385,6 +969,35 @@ void unit_test_window_paint_event()
     w.Destroy();
 }
 
+// test that invalidating multiple regions results in a single
+// paint event that covers all of them.
+void unit_test_window_invalidate_region()
+{
+    unsigned paints = 0;
+    wdk::WindowEventPaint last;
+
+    wdk::Window w;
+    w.OnPaint = [&](const wdk::WindowEventPaint& paint) {
+        last = paint;
+        ++paints;
+    };
+    w.Create("window", 600, 500, 0);
+    ProcessWindowEvents(w, 1);
+
+    paints = 0;
+    w.Invalidate(10, 10, 50, 50);
+    w.Invalidate(100, 200, 20, 30);
+    w.Invalidate(300, 20, 10, 10);
+    ProcessWindowEvents(w, 1);
+    TEST_REQUIRE(paints == 1);
+    TEST_REQUIRE(last.num_rects >= 1);
+    TEST_REQUIRE(last.num_rects <= wdk::WindowEventPaint::MaxRects);
+    TEST_REQUIRE(last.x <= 10);
+    TEST_REQUIRE(last.y <= 10);
+    TEST_REQUIRE(last.x + last.width  >= 310);
+    TEST_REQUIRE(last.y + last.height >= 230);
+}
+
 // test the resize event.
 //
 // we should get this event when the window has been resized.
@@ -469,6 +1082,34 @@ void unit_test_window_resize_event()
     resizeEvent.clear();
 }
 
+// test that a burst of size changes results in a single resize event
+// when resize coalescing is enabled.
+void unit_test_window_resize_coalescing()
+{
+    unsigned resizes = 0;
+    int width  = 0;
+    int height = 0;
+
+    wdk::Window w;
+    w.OnResize = [&](const wdk::WindowEventResize& resize) {
+        width  = resize.width;
+        height = resize.height;
+        ++resizes;
+    };
+    w.Create("window", 600, 500, 0);
+    ProcessWindowEvents(w, 1);
+
+    resizes = 0;
+    w.SetResizeCoalescing(true);
+    w.SetSize(300, 200);
+    w.SetSize(350, 250);
+    w.SetSize(400, 300);
+    ProcessWindowEvents(w, 1);
+    TEST_REQUIRE(resizes == 1);
+    TEST_REQUIRE(width == 400);
+    TEST_REQUIRE(height == 300);
+}
+
 // test the focus lost/gain event.
 void unit_test_window_focus_event()
 {
@@ -515,6 +1156,295 @@ void unit_test_window_focus_event()
 
 }
 
+// test dispatching the window events directly to a listener.
+#if !defined(_WIN32)
+// test that the input snapshot follows the key presses
+// and that losing the focus releases the keys.
+void unit_test_input_snapshot()
+{
+    wdk::Window w;
+    w.Create("input snapshot", 100, 100, 0);
+    ProcessWindowEvents(w, 1);
+
+    ::Display* d = wdk::GetNativeDisplayHandle();
+    const ::Window window = w.GetNativeHandle();
+    const KeyCode code = XKeysymToKeycode(d, XK_a);
+
+    XEvent key = {0};
+    key.xkey.type        = KeyPress;
+    key.xkey.window      = window;
+    key.xkey.root        = DefaultRootWindow(d);
+    key.xkey.keycode     = code;
+    key.xkey.same_screen = True;
+    XSendEvent(d, window, False, KeyPressMask, &key);
+    XSync(d, False);
+    ProcessWindowEvents(w, 1);
+
+    auto snapshot = wdk::GetInputSnapshot();
+    TEST_REQUIRE(snapshot.TestKeyDown(wdk::Keysym::KeyA));
+    TEST_REQUIRE(snapshot.TestKeyDown((wdk::uint_t)code));
+
+    XEvent focus = {0};
+    focus.xfocus.type   = FocusOut;
+    focus.xfocus.window = window;
+    focus.xfocus.mode   = NotifyNormal;
+    focus.xfocus.detail = NotifyNonlinear;
+    XSendEvent(d, window, False, FocusChangeMask, &focus);
+    XSync(d, False);
+    ProcessWindowEvents(w, 1);
+
+    snapshot = wdk::GetInputSnapshot();
+    TEST_REQUIRE(!snapshot.TestKeyDown(wdk::Keysym::KeyA));
+    TEST_REQUIRE(!snapshot.TestKeyDown((wdk::uint_t)code));
+
+    w.Destroy();
+}
+#endif
+
+#if !defined(_WIN32)
+// test that only one window can be in relative mouse mode at a time
+// and that the raw motion is delivered through OnRawMouseMove.
+void unit_test_relative_mouse_mode()
+{
+    wdk::Window a;
+    wdk::Window b;
+    a.Create("relative mouse a", 100, 100, 0);
+    b.Create("relative mouse b", 100, 100, 0);
+    ProcessWindowEvents(a, 1);
+
+    // the mode can't be turned on without XInput2 or when the grab fails.
+    if (a.SetRelativeMouseMode(true))
+    {
+        TEST_REQUIRE(a.SetRelativeMouseMode(true));
+        TEST_REQUIRE(!b.SetRelativeMouseMode(true));
+        TEST_REQUIRE(a.SetRelativeMouseMode(false));
+        TEST_REQUIRE(b.SetRelativeMouseMode(true));
+        TEST_REQUIRE(b.SetRelativeMouseMode(false));
+    }
+    // turning the mode off always works.
+    TEST_REQUIRE(a.SetRelativeMouseMode(false));
+
+    unsigned raw_moves = 0;
+    double dx = 0.0;
+    double dy = 0.0;
+    a.OnRawMouseMove = [&](const wdk::WindowEventRawMouseMove& move) {
+        dx = move.dx;
+        dy = move.dy;
+        ++raw_moves;
+    };
+
+    // the raw motion as converted from the XInput2 raw event.
+    const double delta[2] = {1.5, -2.0};
+    XEvent raw = {0};
+    raw.xclient.type    = wdk::RawMotionEvent;
+    raw.xclient.display = wdk::GetNativeDisplayHandle();
+    raw.xclient.window  = a.GetNativeHandle();
+    std::memcpy(&raw.xclient.data, delta, sizeof(delta));
+    a.ProcessEvent(wdk::native_event_t(raw));
+    TEST_REQUIRE(raw_moves == 1);
+    TEST_REQUIRE(dx == 1.5);
+    TEST_REQUIRE(dy == -2.0);
+
+    a.Destroy();
+    b.Destroy();
+}
+#endif
+
+#if !defined(_WIN32)
+// test that a run of mouse moves for the same window is coalesced
+// into the latest one and that coalescing can be turned off.
+void unit_test_mouse_move_coalescing()
+{
+    wdk::Window a;
+    wdk::Window b;
+    a.Create("coalescing a", 100, 100, 0);
+    b.Create("coalescing b", 100, 100, 0);
+    ProcessWindowEvents(a, 1);
+
+    struct move {
+        const wdk::Window* window;
+        int x;
+        unsigned samples;
+    };
+    std::vector<move> moves;
+    a.OnMouseMove = [&](const wdk::WindowEventMouseMove& m) {
+        moves.push_back(move{&a, m.window_x, m.samples});
+    };
+    b.OnMouseMove = [&](const wdk::WindowEventMouseMove& m) {
+        moves.push_back(move{&b, m.window_x, m.samples});
+    };
+
+    ::Display* d = wdk::GetNativeDisplayHandle();
+    auto SendMotion = [&](const wdk::Window& w, int x) {
+        XEvent ev = {0};
+        ev.xmotion.type        = MotionNotify;
+        ev.xmotion.window      = w.GetNativeHandle();
+        ev.xmotion.root        = DefaultRootWindow(d);
+        ev.xmotion.x           = x;
+        ev.xmotion.y           = x;
+        ev.xmotion.same_screen = True;
+        XSendEvent(d, ev.xmotion.window, False, PointerMotionMask, &ev);
+    };
+    // the sync puts all the events in the queue at once.
+    auto ProcessMotion = [&]() {
+        XSync(d, False);
+        wdk::native_event_t event;
+        while (wdk::PeekEvent(event))
+        {
+            a.ProcessEvent(event);
+            b.ProcessEvent(event);
+        }
+    };
+
+    wdk::SetMouseMoveCoalescing(true);
+    for (int i=1; i<=5; ++i)
+        SendMotion(a, i);
+    ProcessMotion();
+    TEST_REQUIRE(moves.size() == 1);
+    TEST_REQUIRE(moves[0].window == &a);
+    TEST_REQUIRE(moves[0].x == 5);
+    TEST_REQUIRE(moves[0].samples == 5);
+
+    // a move for another window ends the run.
+    moves.clear();
+    SendMotion(a, 1);
+    SendMotion(a, 2);
+    SendMotion(b, 3);
+    SendMotion(a, 4);
+    ProcessMotion();
+    TEST_REQUIRE(moves.size() == 3);
+    TEST_REQUIRE(moves[0].window == &a && moves[0].x == 2 && moves[0].samples == 2);
+    TEST_REQUIRE(moves[1].window == &b && moves[1].x == 3 && moves[1].samples == 1);
+    TEST_REQUIRE(moves[2].window == &a && moves[2].x == 4 && moves[2].samples == 1);
+
+    // every move is delivered when coalescing is off.
+    wdk::SetMouseMoveCoalescing(false);
+    moves.clear();
+    for (int i=1; i<=5; ++i)
+        SendMotion(a, i);
+    ProcessMotion();
+    TEST_REQUIRE(moves.size() == 5);
+    for (int i=0; i<5; ++i)
+    {
+        TEST_REQUIRE(moves[i].x == i + 1);
+        TEST_REQUIRE(moves[i].samples == 1);
+    }
+
+    a.Destroy();
+    b.Destroy();
+}
+#endif
+
+void unit_test_template_dispatch()
+{
+    struct Listener final : public wdk::StaticWindowListener {
+        unsigned creates = 0;
+        unsigned paints  = 0;
+        void OnCreate(const wdk::WindowEventCreate&)
+        { ++creates; }
+        void OnPaint(const wdk::WindowEventPaint& paint)
+        {
+            TEST_REQUIRE(paint.width == 600);
+            TEST_REQUIRE(paint.height == 500);
+            ++paints;
+        }
+    } listener;
+
+    bool callback = false;
+
+    wdk::Window w;
+    w.OnPaint = [&](const wdk::WindowEventPaint&) {
+        callback = true;
+    };
+    w.Create("window", 600, 500, 0);
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    wdk::native_event_t event;
+    while (wdk::PeekEvent(event))
+        w.ProcessEvent(event, listener);
+    TEST_REQUIRE(listener.creates == 1);
+    TEST_REQUIRE(listener.paints);
+    // the callbacks are not invoked.
+    TEST_REQUIRE(callback == false);
+
+    w.Destroy();
+}
+
+// test routing events to multiple windows with the dispatcher.
+void unit_test_event_dispatcher()
+{
+    unsigned paints[3] = {0};
+
+    wdk::Window windows[3];
+    for (int i=0; i<3; ++i)
+    {
+        windows[i].OnPaint = [&paints, i](const wdk::WindowEventPaint&) {
+            ++paints[i];
+        };
+        windows[i].Create("window", 200, 200, 0);
+        windows[i].Move(i * 250, 0);
+        TEST_REQUIRE(wdk::EventDispatcher::GetWindowByHandle(windows[i].GetNativeHandle()) == &windows[i]);
+    }
+
+    wdk::EventDispatcher dispatcher;
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    dispatcher.DispatchPending();
+    TEST_REQUIRE(paints[0]);
+    TEST_REQUIRE(paints[1]);
+    TEST_REQUIRE(paints[2]);
+
+    // only the invalidated window should get painted.
+    paints[0] = paints[1] = paints[2] = 0;
+    windows[1].Invalidate();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    dispatcher.DispatchPending();
+    TEST_REQUIRE(paints[0] == 0);
+    TEST_REQUIRE(paints[1]);
+    TEST_REQUIRE(paints[2] == 0);
+
+    // destroyed window is no longer known.
+    const auto handle = windows[1].GetNativeHandle();
+    windows[1].Destroy();
+    TEST_REQUIRE(wdk::EventDispatcher::GetWindowByHandle(handle) == nullptr);
+
+    // events for the destroyed window go to the fallback.
+    bool unknown_events = false;
+    dispatcher.OnUnknownEvent = [&](const wdk::native_event_t& event) {
+        TEST_REQUIRE(wdk::EventDispatcher::GetWindowByHandle(event.get_window_handle()) == nullptr);
+        unknown_events = true;
+    };
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    dispatcher.DispatchPending();
+    TEST_REQUIRE(unknown_events);
+}
+
+// test creating and destroying windows on another thread
+// while the dispatcher is routing events.
+void unit_test_event_dispatcher_threads()
+{
+    std::atomic<bool> done {false};
+
+    std::thread creator([&]() {
+        for (int i=0; i<50; ++i)
+        {
+            wdk::Window w;
+            w.SetCreateTimeout(0);
+            w.Create("dispatcher thread", 100, 100, 0);
+            // only the dispatching thread touches the window's event state,
+            // this thread just creates and destroys the window.
+            TEST_REQUIRE(wdk::EventDispatcher::GetWindowByHandle(w.GetNativeHandle()) == &w);
+        }
+        done = true;
+    });
+
+    wdk::EventDispatcher dispatcher;
+    while (!done)
+        dispatcher.DispatchPending();
+
+    creator.join();
+    dispatcher.DispatchPending();
+}
+
 void unit_test_window_close_event()
 {
     wdk::Window win;
@@ -641,15 +1571,111 @@ void unit_test_window_mouse_events(wdk::MouseButton expected_button)
     TEST_REQUIRE(on_mouse_release);
 }
 
+#if !defined(_WIN32)
+// test that the input thread's events are timestamped and delivered in
+// order and that they don't pass the events that were already waiting
+// on the application's connection.
+void unit_test_input_thread_order()
+{
+    wdk::StartInputThread();
+
+    wdk::Window w;
+    w.Create("input thread", 100, 100, 0);
+    ProcessWindowEvents(w, 1);
+
+    ::Display* d = wdk::GetNativeDisplayHandle();
+    const ::Window window = w.GetNativeHandle();
+
+    // the expose goes to the application's connection and the
+    // key presses to the input thread's connection.
+    XEvent expose = {0};
+    expose.xexpose.type   = Expose;
+    expose.xexpose.window = window;
+    expose.xexpose.width  = 1;
+    expose.xexpose.height = 1;
+    XSendEvent(d, window, False, ExposureMask, &expose);
+    for (unsigned i=0; i<5; ++i)
+    {
+        XEvent key = {0};
+        key.xkey.type        = KeyPress;
+        key.xkey.window      = window;
+        key.xkey.root        = DefaultRootWindow(d);
+        key.xkey.keycode     = 10 + i;
+        key.xkey.same_screen = True;
+        XSendEvent(d, window, False, KeyPressMask, &key);
+    }
+    XSync(d, False);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    int expose_index = -1;
+    int first_key_index = -1;
+    unsigned next_keycode = 10;
+    std::chrono::steady_clock::time_point previous;
+
+    int index = 0;
+    wdk::native_event_t event;
+    while (wdk::PeekEvent(event))
+    {
+        const XEvent& ev = event;
+        if (ev.type == Expose && ev.xexpose.send_event && ev.xexpose.window == window)
+        {
+            expose_index = index;
+        }
+        else if (ev.type == KeyPress && ev.xkey.window == window)
+        {
+            if (first_key_index == -1)
+                first_key_index = index;
+            TEST_REQUIRE(ev.xkey.keycode == next_keycode++);
+            TEST_REQUIRE(event.get_timestamp().time_since_epoch().count());
+            TEST_REQUIRE(event.get_timestamp() >= previous);
+            previous = event.get_timestamp();
+        }
+        ++index;
+    }
+    TEST_REQUIRE(next_keycode == 15);
+    TEST_REQUIRE(expose_index != -1);
+    TEST_REQUIRE(expose_index < first_key_index);
+
+    w.Destroy();
+}
+#endif
+
 int test_main(int, char*[])
 {
+    unit_test_event_callback();
+    unit_test_display_timings();
     unit_test_video_modes();
+    unit_test_monitors();
     unit_test_keyboard();
     unit_test_window_functions();
+    unit_test_window_geometry();
+    unit_test_event_allocations();
+    unit_test_batch_events();
+    unit_test_wait_event_timeout();
+    unit_test_user_events();
+#if !defined(_WIN32)
+    unit_test_event_replay();
+#endif
     unit_test_window_create_event();
+    unit_test_window_create_nowait();
+    unit_test_resource_batch();
+#if !defined(_WIN32)
+    unit_test_resource_batch_error();
+    unit_test_display_threads();
+#endif
     unit_test_window_paint_event();
+    unit_test_window_invalidate_region();
     unit_test_window_resize_event();
+    unit_test_window_resize_coalescing();
     unit_test_window_focus_event();
+#if !defined(_WIN32)
+    unit_test_input_snapshot();
+    unit_test_relative_mouse_mode();
+    unit_test_mouse_move_coalescing();
+#endif
+    unit_test_template_dispatch();
+    unit_test_event_dispatcher();
+    unit_test_event_dispatcher_threads();
     unit_test_window_close_event();
     unit_test_window_key_event(wdk::Keysym::KeyA, 'a');
     unit_test_window_key_event(wdk::Keysym::KeyZ, 'z');
@@ -663,5 +1689,9 @@ int test_main(int, char*[])
     unit_test_window_mouse_events(wdk::MouseButton::Right);
     // disabled for now, my laptop doesn't have a wheel mouse
     // unit_test_window_mouse_events(wdk::MouseButton::Wheel);
+#if !defined(_WIN32)
+    unit_test_input_thread_order();
+#endif
+    unit_test_window_thread_affinity();
     return 0;
 }
@@ -39,9 +39,15 @@ namespace wdk
         }
     };
 
+    // Order the modes by their size. The modes that have the same
+    // area are ordered by their width so that they don't compare equal.
     inline bool operator < (const VideoMode& lhs, const VideoMode& rhs)
     {
-        return (lhs.xres * lhs.yres) < (rhs.xres * rhs.yres);
+        const auto lhs_area = lhs.xres * lhs.yres;
+        const auto rhs_area = rhs.xres * rhs.yres;
+        if (lhs_area != rhs_area)
+            return lhs_area < rhs_area;
+        return lhs.xres < rhs.xres;
     }
 
     inline
@@ -0,0 +1,77 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include <windows.h>
+#include <stdexcept>
+#include <mutex>
+#include <vector>
+
+#include "wdk/display.h"
+
+namespace wdk
+{
+
+struct Display::impl {
+    HDC hdc = NULL;
+    std::mutex close_mutex;
+    std::vector<std::function<void ()>> close_handlers;
+};
+
+Display::Display() : pimpl_(new impl)
+{
+    pimpl_->hdc = GetDC(NULL);
+    if (pimpl_->hdc == NULL)
+        throw std::runtime_error("get desktop dc failed");
+}
+
+Display::~Display()
+{
+    for (const auto& handler : pimpl_->close_handlers)
+        handler();
+
+    ReleaseDC(NULL, pimpl_->hdc);
+}
+
+native_display_t Display::GetNativeHandle() const
+{
+    return pimpl_->hdc;
+}
+
+DisplayTimings Display::GetTimings() const
+{
+    // nothing to set up.
+    return DisplayTimings{};
+}
+
+void Display::AddCloseHandler(std::function<void ()> handler)
+{
+    std::lock_guard<std::mutex> lock(pimpl_->close_mutex);
+    pimpl_->close_handlers.push_back(std::move(handler));
+}
+
+Display& Display::GetDefault()
+{
+    static Display display;
+    return display;
+}
+
+} // wdk
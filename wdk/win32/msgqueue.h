@@ -23,14 +23,22 @@
 #include <Windows.h>
 
 #include <queue>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+#include "wdk/win32/messages.h"
 
 namespace wdk
 {
     namespace impl {
         using WindowMessageQueue = std::queue<MSG>;
+        // the messages of a window go to the thread that created it,
+        // so every thread that pumps events has its own queue.
         inline WindowMessageQueue& GetGlobalWindowMessageQueue()
         {
-            static WindowMessageQueue queue;
+            thread_local WindowMessageQueue queue;
             return queue;
         }
         inline void PutGlobalWindowMessage(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
@@ -59,6 +67,63 @@ namespace wdk
             queue.pop();
             return true;
         }
+        // the thread that is pumping the event queue. user events
+        // are posted to this thread's message queue.
+        inline std::atomic<DWORD>& GetEventThreadId()
+        {
+            static std::atomic<DWORD> id {0};
+            return id;
+        }
+        // the user events posted before any thread has pumped events.
+        // bounded like the user event queue on X11.
+        struct PendingUserEvents {
+            static const std::size_t MaxSize = 1024;
+            std::mutex mutex;
+            std::vector<std::uintptr_t> payloads;
+        };
+        inline PendingUserEvents& GetPendingUserEvents()
+        {
+            static PendingUserEvents pending;
+            return pending;
+        }
+        // Make the calling thread the event thread unless some thread
+        // already is. The first thread that pumps events keeps the
+        // user events even when other threads pump their own windows.
+        // The user events posted before that are delivered first.
+        inline void SetEventThreadId()
+        {
+            auto& id = GetEventThreadId();
+            if (id.load(std::memory_order_acquire))
+                return;
+
+            auto& pending = GetPendingUserEvents();
+            std::lock_guard<std::mutex> lock(pending.mutex);
+            if (id.load(std::memory_order_relaxed))
+                return;
+
+            for (const auto payload : pending.payloads)
+            {
+                MSG m = { 0 };
+                m.message = WM_USER_EVENT;
+                m.wParam  = (WPARAM)payload;
+                GetGlobalWindowMessageQueue().push(m);
+            }
+            pending.payloads.clear();
+            // only published once the pending events are in the queue
+            // so that a later event can't be posted ahead of them.
+            id.store(GetCurrentThreadId(), std::memory_order_release);
+        }
+        // Move a user event thread message to the window message queue.
+        // Returns true if the message was a user event.
+        inline bool PutGlobalUserMessage(const MSG& m)
+        {
+            if (m.message != WM_USER_EVENT)
+                return false;
+            // no collapsing of consecutive messages here, each
+            // user event is delivered.
+            GetGlobalWindowMessageQueue().push(m);
+            return true;
+        }
         inline bool HasGlobalWindowMessage()
         {
             auto& queue = GetGlobalWindowMessageQueue();
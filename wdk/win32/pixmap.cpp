@@ -51,6 +51,12 @@ Pixmap::Pixmap(uint_t width, uint_t height, uint_t visualid)
     pimpl_->depth  = 4; 
 }
 
+Pixmap::Pixmap(Display&, uint_t width, uint_t height, uint_t visualid)
+    : Pixmap(width, height, visualid)
+{
+    // bitmaps are not tied to a display.
+}
+
 Pixmap::~Pixmap()
 {
     DeleteObject(pimpl_->bmp);
@@ -21,11 +21,14 @@
 //  THE SOFTWARE.
 
 #include <algorithm>
+#include <mutex>
 #include <cassert>
 
 #include "wdk/system.h"
 #include "wdk/videomode.h"
+#include "wdk/monitor.h"
 #include "wdk/keys.h"
+#include "wdk/input.h"
 #include "wdk/win32/msgqueue.h"
 
 namespace {
@@ -136,20 +139,128 @@ namespace {
 
     enum { KEY_DOWN = 0x8000 };
 
+    // The input state is updated by the threads pumping the
+    // events and a snapshot can be taken on any thread.
+    struct InputState {
+        std::mutex mutex;
+        InputSnapshot snapshot;
+    };
+
+    InputState& GetInputState()
+    {
+        static InputState state;
+        return state;
+    }
+
+    Keysym find_virtual_key(UINT vk)
+    {
+        const auto it = std::find_if(std::begin(keymap), std::end(keymap),
+            [=](const key_mapping& map)
+            {
+                return map.win == vk;
+            });
+        if (it == std::end(keymap))
+            return Keysym::None;
+        return (*it).wdk;
+    }
+
+    // update the tracked input state from the message.
+    void UpdateInputState(const MSG& m)
+    {
+        InputState& input = GetInputState();
+        std::lock_guard<std::mutex> lock(input.mutex);
+        InputSnapshot& state = input.snapshot;
+
+        switch (m.message)
+        {
+            case WM_KEYDOWN:
+            case WM_KEYUP:
+                {
+                    const bool down = m.message == WM_KEYDOWN;
+                    UINT vk = (UINT)m.wParam;
+                    state.keycodes.set(vk & 0xff, down);
+
+                    // resolve the left/right versions of the modifier keys.
+                    const bool extended = (m.lParam & (1 << 24)) != 0;
+                    if (vk == VK_SHIFT)
+                        vk = MapVirtualKey((m.lParam >> 16) & 0xff, MAPVK_VSC_TO_VK_EX);
+                    else if (vk == VK_CONTROL)
+                        vk = extended ? VK_RCONTROL : VK_LCONTROL;
+                    else if (vk == VK_MENU)
+                        vk = extended ? VK_RMENU : VK_LMENU;
+
+                    const Keysym key = find_virtual_key(vk);
+                    if (key != Keysym::None)
+                        state.keys.set(static_cast<unsigned>(key), down);
+                }
+                break;
+
+            case WM_LBUTTONDOWN:
+            case WM_LBUTTONUP:
+                state.buttons.set(MouseButton::Left, m.message == WM_LBUTTONDOWN);
+                break;
+            case WM_MBUTTONDOWN:
+            case WM_MBUTTONUP:
+                state.buttons.set(MouseButton::Wheel, m.message == WM_MBUTTONDOWN);
+                break;
+            case WM_RBUTTONDOWN:
+            case WM_RBUTTONUP:
+                state.buttons.set(MouseButton::Right, m.message == WM_RBUTTONDOWN);
+                break;
+
+            case WM_MOUSEMOVE:
+                {
+                    POINT pt;
+                    pt.x = (short)LOWORD(m.lParam);
+                    pt.y = (short)HIWORD(m.lParam);
+                    state.mouse_window_x = pt.x;
+                    state.mouse_window_y = pt.y;
+                    ClientToScreen(m.hwnd, &pt);
+                    state.mouse_global_x = pt.x;
+                    state.mouse_global_y = pt.y;
+                }
+                break;
+
+            case WM_SETFOCUS:
+                {
+                    BYTE key_states[256];
+                    GetKeyboardState(key_states);
+                    state.keycodes.reset();
+                    state.keys.reset();
+                    for (UINT vk=0; vk<256; ++vk)
+                    {
+                        if (!(key_states[vk] & 0x80))
+                            continue;
+                        state.keycodes.set(vk);
+                        const Keysym key = find_virtual_key(vk);
+                        if (key != Keysym::None)
+                            state.keys.set(static_cast<unsigned>(key));
+                    }
+                }
+                break;
+
+            case WM_KILLFOCUS:
+                state.keycodes.reset();
+                state.keys.reset();
+                state.buttons.clear();
+                break;
+        }
+    }
+
 } // namespace
 
 namespace wdk
 {
 native_display_t GetNativeDisplayHandle()
 {
-    class Display
+    class SystemWindow
     {
     public:
-        Display()
+        SystemWindow()
         {
             WNDCLASSEX cls    = {0};
             cls.cbSize        = sizeof(cls);
-            cls.lpfnWndProc   = Display::WndProc;
+            cls.lpfnWndProc   = SystemWindow::WndProc;
             cls.lpszClassName = TEXT("WDK-SYSTEM-WINDOW");
             RegisterClassEx(&cls);
 
@@ -162,19 +273,11 @@ native_display_t GetNativeDisplayHandle()
                 NULL, NULL, NULL, NULL);
             if (m_wnd_system == NULL)
                 throw std::runtime_error("create system window failed");
-            m_hdc_desktop = GetDC(NULL);
-
         }
-       ~Display()
+       ~SystemWindow()
         {
-            BOOL ret = TRUE;
-            ret = ReleaseDC(GetDesktopWindow(), m_hdc_desktop);
-            assert(ret == TRUE);
-            ret = DestroyWindow(m_wnd_system);
-            (void)ret;
+            DestroyWindow(m_wnd_system);
         }
-        HDC getDesktopHDC() const
-        { return m_hdc_desktop; }
     private:
         static
         LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
@@ -185,13 +288,17 @@ native_display_t GetNativeDisplayHandle()
         }
 
     private:
-        HDC   m_hdc_desktop;
         HWND  m_wnd_system;
     };
 
-    static Display disp;
+    static SystemWindow window;
+
+    return Display::GetDefault().GetNativeHandle();
+}
 
-    return disp.getDesktopHDC();
+DisplayTimings GetDisplayTimings()
+{
+    return Display::GetDefault().GetTimings();
 }
 
 VideoMode GetCurrentVideoMode()
@@ -245,8 +352,80 @@ std::vector<VideoMode> ListVideoModes()
     return modes;
 }
 
-LPVOID caller_fiber_handle = nullptr;
-LPVOID msgloop_fiber_handle = nullptr;
+std::vector<Monitor> ListMonitors()
+{
+    std::vector<Monitor> monitors;
+
+    DISPLAY_DEVICEA device = {0};
+    device.cb = sizeof(device);
+
+    for (DWORD index=0; EnumDisplayDevicesA(NULL, index, &device, 0); ++index)
+    {
+        if (!(device.StateFlags & DISPLAY_DEVICE_ATTACHED_TO_DESKTOP))
+            continue;
+
+        DEVMODEA cur = {0};
+        cur.dmSize = sizeof(cur);
+        if (!EnumDisplaySettingsA(device.DeviceName, ENUM_CURRENT_SETTINGS, &cur))
+            continue;
+
+        Monitor monitor;
+        monitor.id      = index;
+        monitor.name    = device.DeviceName;
+        monitor.primary = (device.StateFlags & DISPLAY_DEVICE_PRIMARY_DEVICE) != 0;
+        monitor.x       = cur.dmPosition.x;
+        monitor.y       = cur.dmPosition.y;
+        monitor.width   = cur.dmPelsWidth;
+        monitor.height  = cur.dmPelsHeight;
+
+        DEVMODEA dev = {0};
+        dev.dmSize = sizeof(dev);
+        for (DWORD modeid = 0; EnumDisplaySettingsA(device.DeviceName, modeid, &dev); ++modeid)
+        {
+            // the same mode is listed once for every color depth.
+            if (dev.dmBitsPerPel != cur.dmBitsPerPel)
+                continue;
+
+            MonitorMode mode;
+            mode.id   = modeid;
+            mode.xres = dev.dmPelsWidth;
+            mode.yres = dev.dmPelsHeight;
+            mode.refresh_rate = dev.dmDisplayFrequency;
+            monitor.modes.push_back(mode);
+
+            if (mode.xres == cur.dmPelsWidth && mode.yres == cur.dmPelsHeight &&
+                dev.dmDisplayFrequency == cur.dmDisplayFrequency)
+                monitor.current = mode;
+        }
+        monitors.push_back(monitor);
+    }
+    return monitors;
+}
+
+void SetMonitorMode(const Monitor& monitor, const MonitorMode& m)
+{
+    DISPLAY_DEVICEA device = {0};
+    device.cb = sizeof(device);
+    if (!EnumDisplayDevicesA(NULL, (DWORD)monitor.id, &device, 0))
+        throw std::runtime_error("no such monitor");
+
+    DEVMODEA mode = {0};
+    mode.dmSize = sizeof(mode);
+    if (!EnumDisplaySettingsA(device.DeviceName, (DWORD)m.id, &mode))
+        throw std::runtime_error("invalid video mode");
+    mode.dmFields = DM_PELSWIDTH | DM_PELSHEIGHT | DM_DISPLAYFREQUENCY;
+
+    // create the window for the display change notification.
+    GetNativeDisplayHandle();
+
+    if (ChangeDisplaySettingsExA(device.DeviceName, &mode, NULL, 0, NULL) != DISP_CHANGE_SUCCESSFUL)
+       throw std::runtime_error("display mode change failed");
+}
+
+// every thread that pumps events converts itself into a fiber
+// and runs its own message loop fiber.
+thread_local LPVOID caller_fiber_handle = nullptr;
+thread_local LPVOID msgloop_fiber_handle = nullptr;
 
 void PeekEventFiberDelegate(LPVOID param)
 {
@@ -256,6 +435,8 @@ void PeekEventFiberDelegate(LPVOID param)
     {
         while (PeekMessage(&m, NULL, 0, 0, PM_REMOVE))
         {
+            if (impl::PutGlobalUserMessage(m))
+                continue;
             // translate virtual key messages into unicode characters
             // which are posted in WM_CHAR (UTF-16)
             // this works fine for BMP in the range 0x0000 - 0xD7FF, 0xE000 - 0xFFFF.
@@ -333,6 +514,8 @@ bool PeekEvent(native_event_t& ev)
     // Todo: skip the fiber creation if the window can never be moved/resized (i.e. in 
     // fullscreen mode always ?)
 
+    impl::SetEventThreadId();
+
     if (caller_fiber_handle == nullptr) 
     {
         // this is now the apps "main" fiber.
@@ -352,12 +535,15 @@ bool PeekEvent(native_event_t& ev)
     if (!impl::GetGlobalWindowMessage(&m))
         return false;
 
+    UpdateInputState(m);
     ev = native_event_t(m);
     return true;
 }
 
 void WaitEvent(native_event_t& ev)
 {
+    impl::SetEventThreadId();
+
     MSG m;
 
     while (!impl::HasGlobalWindowMessage())
@@ -368,6 +554,9 @@ void WaitEvent(native_event_t& ev)
         if (GetMessage(&m, NULL, 0, 0) == -1)
             throw std::runtime_error("GetMessage failed");
 
+        if (impl::PutGlobalUserMessage(m))
+            continue;
+
         // translate virtual key messages into unicode characters
         // which are posted in WM_CHAR (UTF-16)
         // this works fine for BMP in the range 0x0000 - 0xD7FF, 0xE000 - 0xFFFF.
@@ -377,9 +566,159 @@ void WaitEvent(native_event_t& ev)
     }
 
     impl::GetGlobalWindowMessage(&m);
+    UpdateInputState(m);
     ev = native_event_t(m);
 }
 
+bool WaitEvent(native_event_t& ev, ms_t timeout)
+{
+    if (timeout == NO_TIMEOUT)
+    {
+        WaitEvent(ev);
+        return true;
+    }
+
+    impl::SetEventThreadId();
+
+    const DWORD start = GetTickCount();
+
+    MSG m;
+
+    while (!impl::HasGlobalWindowMessage())
+    {
+        if (PeekMessage(&m, NULL, 0, 0, PM_REMOVE))
+        {
+            if (impl::PutGlobalUserMessage(m))
+                continue;
+            TranslateMessage(&m);
+            DispatchMessage(&m);
+            continue;
+        }
+        const DWORD elapsed = GetTickCount() - start;
+        if (elapsed >= timeout)
+            return false;
+
+        // wait for any new message to arrive in the thread's message queue.
+        MsgWaitForMultipleObjects(0, NULL, FALSE, timeout - elapsed, QS_ALLINPUT);
+    }
+
+    impl::GetGlobalWindowMessage(&m);
+    UpdateInputState(m);
+    ev = native_event_t(m);
+    return true;
+}
+
+std::size_t PeekEvents(native_event_t* out, std::size_t max)
+{
+    std::size_t count = 0;
+    for (; count < max; ++count)
+    {
+        if (!PeekEvent(out[count]))
+            break;
+    }
+    return count;
+}
+
+std::size_t WaitEvents(native_event_t* out, std::size_t max)
+{
+    assert(max);
+
+    WaitEvent(out[0]);
+
+    return 1 + PeekEvents(out + 1, max - 1);
+}
+
+bool PeekEvent(Display&, native_event_t& ev)
+{
+    // the messages go to the thread that created the window
+    // so each thread already has its own queue.
+    return PeekEvent(ev);
+}
+
+bool WaitEvent(Display&, native_event_t& ev, ms_t timeout)
+{
+    return WaitEvent(ev, timeout);
+}
+
+bool PostUserEvent(std::uintptr_t payload)
+{
+    // the event thread is only known once it has started pumping events.
+    // until then the events are held back (see impl::SetEventThreadId).
+    DWORD thread = impl::GetEventThreadId().load(std::memory_order_acquire);
+    if (thread == 0)
+    {
+        auto& pending = impl::GetPendingUserEvents();
+        std::lock_guard<std::mutex> lock(pending.mutex);
+        thread = impl::GetEventThreadId().load(std::memory_order_relaxed);
+        if (thread == 0)
+        {
+            if (pending.payloads.size() == impl::PendingUserEvents::MaxSize)
+                return false;
+            pending.payloads.push_back(payload);
+            return true;
+        }
+    }
+    return PostThreadMessage(thread, impl::WM_USER_EVENT, (WPARAM)payload, 0) == TRUE;
+}
+
+std::uintptr_t GetUserEventPayload(const native_event_t& ev)
+{
+    assert(ev.identity() == native_event_t::type::user);
+
+    const MSG& m = ev;
+    return static_cast<std::uintptr_t>(m.wParam);
+}
+
+void StartInputThread()
+{
+    // window input is delivered to the thread that owns the window.
+}
+
+void SetWindowThreadAffinity(native_window_t)
+{
+    // the messages already go to the thread that created the window.
+}
+
+void ClearWindowThreadAffinity(native_window_t)
+{
+    // the messages already go to the thread that created the window.
+}
+
+bool PeekThreadEvent(native_event_t& ev)
+{
+    return PeekEvent(ev);
+}
+
+bool WaitThreadEvent(native_event_t& ev, ms_t timeout)
+{
+    return WaitEvent(ev, timeout);
+}
+
+void SetMouseMoveCoalescing(bool)
+{
+    // Windows already coalesces WM_MOUSEMOVE messages.
+}
+
+void BeginResourceBatch()
+{
+    // resource creation is synchronous.
+}
+
+void EndResourceBatch()
+{
+    // resource creation is synchronous.
+}
+
+void BeginResourceBatch(Display&)
+{
+    // resource creation is synchronous.
+}
+
+void EndResourceBatch(Display&)
+{
+    // resource creation is synchronous.
+}
+
 std::pair<bitflag<Keymod>, Keysym> TranslateKeydownEvent(const native_event_t& key)
 {
     const MSG& m = key;
@@ -483,6 +822,13 @@ std::pair<bitflag<Keymod>, MouseButton> TranslateMouseButtonEvent(const native_e
     return ret;
 }
 
+InputSnapshot GetInputSnapshot()
+{
+    InputState& input = GetInputState();
+    std::lock_guard<std::mutex> lock(input.mutex);
+    return input.snapshot;
+}
+
 bool TestKeyDown(Keysym symbol)
 {
     const UINT win    = find_keysym(symbol);
@@ -23,6 +23,9 @@
 #pragma once
 
 #include <windows.h>
+#include <chrono>
+
+#include "wdk/win32/messages.h"
 
 namespace wdk
 {
@@ -48,7 +51,9 @@ namespace wdk
             window_mouse_move,
             window_mouse_press,
             window_mouse_release,
+            window_raw_mouse_move,
             system_resolution_change,
+            user,
             other
         };
 
@@ -56,7 +61,7 @@ namespace wdk
         {
             msg_ = MSG{0};
         }
-        native_event_t(const MSG& m) : msg_(m)
+        native_event_t(const MSG& m) : msg_(m), timestamp_(std::chrono::steady_clock::now())
         {}
 
         operator const MSG& () const
@@ -72,6 +77,19 @@ namespace wdk
             return msg_;
         }
 
+        // Windows coalesces mouse moves itself, each event
+        // represents a single sample.
+        unsigned get_sample_count() const
+        {
+            return 1;
+        }
+
+        // get the time when the event was taken out of the message queue.
+        std::chrono::steady_clock::time_point get_timestamp() const
+        {
+            return timestamp_;
+        }
+
         type identity() const
         {
             switch (msg_.message)
@@ -88,6 +106,7 @@ namespace wdk
                 case WM_CHAR:          return type::window_char;
                 case WM_DISPLAYCHANGE: return type::system_resolution_change;
                 case WM_MOUSEMOVE:     return type::window_mouse_move;
+                case impl::WM_USER_EVENT: return type::user;
 
                 case WM_LBUTTONDOWN:
                 case WM_RBUTTONDOWN:
@@ -106,6 +125,7 @@ namespace wdk
         }
     private:
         MSG msg_;
+        std::chrono::steady_clock::time_point timestamp_;
     };
 
 } // wdk
@@ -30,12 +30,21 @@
 
 #include "wdk/events.h"
 #include "wdk/window.h"
+#include "wdk/dispatcher.h"
 #include "wdk/system.h"
 #include "wdk/utf8.h"
 #include "wdk/win32/msgqueue.h"
 
 #pragma comment(lib, "User32.lib")
 
+namespace {
+    // the windows on other displays are not added to the event dispatcher.
+    bool IsDefaultDisplay(const wdk::Display* display)
+    {
+        return !display || display == &wdk::Display::GetDefault();
+    }
+} // namespace
+
 namespace wdk
 {
 
@@ -43,6 +52,8 @@ namespace wdk
 extern LPVOID caller_fiber_handle;
 
 struct Window::impl {
+    // the display the window is created on, nullptr for the default.
+    Display* display = nullptr;
     HWND window = NULL;
     Encoding enc = Encoding::UTF8;
     bool fullscreen = false;
@@ -51,6 +62,10 @@ struct Window::impl {
     bool was_cursor_shown = true;
     bool has_mouse_focus = false;
     bool mouse_grab = false;
+    bool coalesce_resize = false;
+    // the latest size reported through OnResize
+    LONG resize_width  = 0;
+    LONG resize_height = 0;
     int x = 0;
     int y = 0;
     int w = 0;
@@ -100,6 +115,11 @@ struct Window::impl {
                }
                return 0;
 
+            // keep the default processing for the owned windows.
+            case WM_SHOWWINDOW:
+                wdk::impl::PutGlobalWindowMessage(hwnd, msg, wp, lp);
+                break;
+
             case WM_KILLFOCUS:
             case WM_SETFOCUS:
             case WM_SIZE:
@@ -200,6 +220,11 @@ Window::Window() : pimpl_(new impl)
 
 }
 
+Window::Window(Display& display) : Window()
+{
+    pimpl_->display = &display;
+}
+
 Window::~Window()
 {
     if (DoesExist())
@@ -293,6 +318,9 @@ void Window::Create(const std::string& title, uint_t width, uint_t height, uint_
     pimpl_->resizing   = false;
     pimpl_->x          = 0;
     pimpl_->y          = 0;
+
+    if (IsDefaultDisplay(pimpl_->display))
+        EventDispatcher::AddWindow(GetNativeHandle(), this);
 }
 
 void Window::Hide()
@@ -313,6 +341,9 @@ void Window::Destroy()
 {
     assert(DoesExist());
 
+    if (IsDefaultDisplay(pimpl_->display))
+        EventDispatcher::RemoveWindow(GetNativeHandle());
+
     const BOOL ret = DestroyWindow(pimpl_->window);
 
     assert(ret);
@@ -327,6 +358,23 @@ void Window::Invalidate()
     InvalidateRect(pimpl_->window, NULL, TRUE);
 }
 
+void Window::Invalidate(int x, int y, int width, int height)
+{
+    assert(DoesExist());
+
+    if (width <= 0 || height <= 0)
+        return;
+
+    // the system accumulates the update region and
+    // generates a single WM_PAINT for it.
+    RECT rc;
+    rc.left   = x;
+    rc.top    = y;
+    rc.right  = x + width;
+    rc.bottom = y + height;
+    InvalidateRect(pimpl_->window, &rc, FALSE);
+}
+
 void Window::Move(int x, int y)
 {
     assert(DoesExist());
@@ -495,6 +543,12 @@ bool Window::GrabMouse(bool on_off)
     return true;
 }
 
+bool Window::SetRelativeMouseMode(bool on)
+{
+    // not implemented, would need the raw input API (WM_INPUT).
+    return !on;
+}
+
 void Window::SetFocus()
 {
     assert(DoesExist());
@@ -547,6 +601,16 @@ void Window::SetEncoding(Encoding enc)
     pimpl_->enc = enc;
 }
 
+void Window::SetResizeCoalescing(bool on)
+{
+    pimpl_->coalesce_resize = on;
+}
+
+void Window::SetCreateTimeout(ms_t)
+{
+    // ShowWindow is synchronous, there's nothing to wait for.
+}
+
 void Window::SetTitle(const std::string& title)
 {
     HWND hwnd = pimpl_->window;
@@ -554,29 +618,51 @@ void Window::SetTitle(const std::string& title)
     SetWindowTextW(hwnd, wide.c_str());
 }
 
-bool Window::ProcessEvent(const native_event_t& ev)
+bool Window::DecodeEvent(const native_event_t& ev, WindowEvent* events, unsigned& count,
+    bitflag<WindowEvent::Type> wanted)
 {
+    count = 0;
+
     if (ev.get_window_handle() != GetNativeHandle())
         return false;
 
     const MSG& m = ev;
 
+    WindowEvent& out = events[0];
+
     switch (m.message)
     {
         case WM_SETFOCUS:
-            if (OnGainFocus)
-                OnGainFocus(WindowEventGainFocus{});
+            if (wanted.test(WindowEvent::Type::GainFocus))
+            {
+                out.type = WindowEvent::Type::GainFocus;
+                count = 1;
+            }
             break;
 
         case WM_KILLFOCUS:
-            if (OnLostFocus)
-                OnLostFocus(WindowEventLostFocus{});
+            if (wanted.test(WindowEvent::Type::LostFocus))
+            {
+                out.type = WindowEvent::Type::LostFocus;
+                count = 1;
+            }
+            break;
+
+        case WM_SHOWWINDOW:
+            if (m.wParam && wanted.test(WindowEvent::Type::Show))
+            {
+                out.type = WindowEvent::Type::Show;
+                count = 1;
+            }
             break;
 
         case WM_PAINT:
-            if (OnPaint)
             {
                 RECT rcPaint = pimpl_->rcPaint;
+                pimpl_->rcPaint = RECT{ 0 };
+                if (!wanted.test(WindowEvent::Type::Paint))
+                    break;
+
                 if (IsRectEmpty(&rcPaint))
 					GetUpdateRect(m.hwnd, &rcPaint, FALSE);
 
@@ -588,21 +674,41 @@ bool Window::ProcessEvent(const native_event_t& ev)
                 paint.y = rcPaint.top;
                 paint.width = rcPaint.right - rcPaint.left;
                 paint.height = rcPaint.bottom - rcPaint.top;
-                OnPaint(paint);
+                // the update region has already been collapsed
+                // into a single rectangle by the window procedure.
+                paint.rects[0].x = paint.x;
+                paint.rects[0].y = paint.y;
+                paint.rects[0].width  = paint.width;
+                paint.rects[0].height = paint.height;
+                paint.num_rects = 1;
+                out.type  = WindowEvent::Type::Paint;
+                out.paint = paint;
+                count = 1;
             }
-            pimpl_->rcPaint = RECT{ 0 };
             break;
 
         case WM_SIZE:
-            if (OnResize)
             {
                 RECT rc;
                 GetClientRect(m.hwnd, &rc);
 
+                // the message queue already collapses consecutive WM_SIZE messages
+                // and the size is read from the window directly. Only need
+                // to filter out messages that don't change the size anymore.
+                if (pimpl_->coalesce_resize &&
+                    pimpl_->resize_width == rc.right && pimpl_->resize_height == rc.bottom)
+                    break;
+                pimpl_->resize_width  = rc.right;
+                pimpl_->resize_height = rc.bottom;
+                if (!wanted.test(WindowEvent::Type::Resize))
+                    break;
+
                 WindowEventResize resize;
                 resize.width  = rc.right;
                 resize.height = rc.bottom;
-                OnResize(resize);
+                out.type   = WindowEvent::Type::Resize;
+                out.resize = resize;
+                count = 1;
             }
             break;
 
@@ -615,39 +721,53 @@ bool Window::ProcessEvent(const native_event_t& ev)
                 create.width      = ptr->cx;
                 create.height     = ptr->cy;
                 delete ptr;
-                if (OnCreate)
-                    OnCreate(create);
+                if (!wanted.test(WindowEvent::Type::Create))
+                    break;
+                out.type   = WindowEvent::Type::Create;
+                out.create = create;
+                count = 1;
             }
             break;
 
         case WM_CLOSE:
-            if (OnWantClose)
-                OnWantClose(WindowEventWantClose{});
+            if (wanted.test(WindowEvent::Type::WantClose))
+            {
+                out.type = WindowEvent::Type::WantClose;
+                count = 1;
+            }
             break;
 
 
         case WM_KEYDOWN:
-            if (OnKeyDown)
             {
+                if (!wanted.test(WindowEvent::Type::KeyDown))
+                    break;
+
                 const auto& keys = TranslateKeydownEvent(ev);
                 if (keys.second != Keysym::None) {
                     WindowEventKeyDown key;
                     key.modifiers = keys.first;
                     key.symbol = keys.second;
-                    OnKeyDown(key);
+                    out.type = WindowEvent::Type::KeyDown;
+                    out.key_down = key;
+                    count = 1;
                 }
             }
             break;
 
         case WM_KEYUP:
-            if (OnKeyUp)
             {
+                if (!wanted.test(WindowEvent::Type::KeyUp))
+                    break;
+
                 const auto& keys = TranslateKeydownEvent(ev);
                 if (keys.second != Keysym::None) {
                     WindowEventKeyUp key;
                     key.modifiers = keys.first;
                     key.symbol = keys.second;
-                    OnKeyUp(key);
+                    out.type = WindowEvent::Type::KeyUp;
+                    out.key_up = key;
+                    count = 1;
                 }
             }
             break;
@@ -682,7 +802,7 @@ bool Window::ProcessEvent(const native_event_t& ev)
                 TrackMouseEvent(&tracking);
             }
 
-            if (OnMouseMove)
+            if (wanted.test(WindowEvent::Type::MouseMove))
             {
                 const auto& button = TranslateMouseButtonEvent(ev);
 
@@ -695,7 +815,9 @@ bool Window::ProcessEvent(const native_event_t& ev)
                 mickey.global_y  = global.y;
                 mickey.modifiers = button.first;
                 mickey.btn       = button.second;
-                OnMouseMove(mickey);
+                out.type = WindowEvent::Type::MouseMove;
+                out.mouse_move = mickey;
+                count = 1;
             }
             break;
 
@@ -703,8 +825,10 @@ bool Window::ProcessEvent(const native_event_t& ev)
         case WM_LBUTTONDOWN:
         case WM_RBUTTONDOWN:
         case WM_MBUTTONDOWN:
-            if (OnMousePress)
             {
+                if (!wanted.test(WindowEvent::Type::MousePress))
+                    break;
+
                 const auto& button = TranslateMouseButtonEvent(ev);
 
                 POINT global;
@@ -716,15 +840,19 @@ bool Window::ProcessEvent(const native_event_t& ev)
                 mickey.global_y  = global.y;
                 mickey.modifiers = button.first;
                 mickey.btn       = button.second;
-                OnMousePress(mickey);
+                out.type = WindowEvent::Type::MousePress;
+                out.mouse_press = mickey;
+                count = 1;
             }
             break;
 
         case WM_LBUTTONUP:
         case WM_RBUTTONUP:
         case WM_MBUTTONUP:
-            if (OnMouseRelease)
             {
+                if (!wanted.test(WindowEvent::Type::MouseRelease))
+                    break;
+
                 const auto& button = TranslateMouseButtonEvent(ev);
 
                 POINT global;
@@ -736,13 +864,17 @@ bool Window::ProcessEvent(const native_event_t& ev)
                 mickey.global_y  = global.y;
                 mickey.modifiers = button.first;
                 mickey.btn       = button.second;
-                OnMouseRelease(mickey);
+                out.type = WindowEvent::Type::MouseRelease;
+                out.mouse_release = mickey;
+                count = 1;
             }
             break;
 
         case WM_CHAR:
-            if (OnChar)
             {
+                if (!wanted.test(WindowEvent::Type::Char))
+                    break;
+
                 const WPARAM utf16 = m.wParam;
 
                 WindowEventChar c = {0};
@@ -753,8 +885,9 @@ bool Window::ProcessEvent(const native_event_t& ev)
                 else if (pimpl_->enc == Encoding::UTF8)
                     enc::utf8_encode(&utf16, &utf16 + 1, &c.utf8[0]);
 
-                OnChar(c);
-
+                out.type = WindowEvent::Type::Char;
+                out.character = c;
+                count = 1;
             }
             break;
 
@@ -800,6 +933,23 @@ int Window::GetPosY() const
     return rc.top;
 }
 
+Window::Geometry Window::GetGeometry() const
+{
+    assert(DoesExist());
+
+    RECT window = {0};
+    RECT client = {0};
+    GetWindowRect(pimpl_->window, &window);
+    GetClientRect(pimpl_->window, &client);
+
+    Geometry ret;
+    ret.x = window.left;
+    ret.y = window.top;
+    ret.width  = client.right;
+    ret.height = client.bottom;
+    return ret;
+}
+
 bool Window::DoesExist() const
 {
     return pimpl_->window != NULL;
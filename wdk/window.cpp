@@ -0,0 +1,109 @@
+// Copyright (c) 2013 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+
+#include "wdk/window.h"
+#include "wdk/events.h"
+
+namespace {
+
+// Adapt the window's callbacks to the listener interface
+// so that they can be invoked through Dispatch.
+struct CallbackListener {
+    wdk::Window& window;
+
+    void OnCreate(const wdk::WindowEventCreate& event)
+    { if (window.OnCreate) window.OnCreate(event); }
+    void OnShow(const wdk::WindowEventShow& event)
+    { if (window.OnShow) window.OnShow(event); }
+    void OnPaint(const wdk::WindowEventPaint& event)
+    { if (window.OnPaint) window.OnPaint(event); }
+    void OnResize(const wdk::WindowEventResize& event)
+    { if (window.OnResize) window.OnResize(event); }
+    void OnLostFocus(const wdk::WindowEventLostFocus& event)
+    { if (window.OnLostFocus) window.OnLostFocus(event); }
+    void OnGainFocus(const wdk::WindowEventGainFocus& event)
+    { if (window.OnGainFocus) window.OnGainFocus(event); }
+    void OnWantClose(const wdk::WindowEventWantClose& event)
+    { if (window.OnWantClose) window.OnWantClose(event); }
+    void OnKeyDown(const wdk::WindowEventKeyDown& event)
+    { if (window.OnKeyDown) window.OnKeyDown(event); }
+    void OnKeyUp(const wdk::WindowEventKeyUp& event)
+    { if (window.OnKeyUp) window.OnKeyUp(event); }
+    void OnChar(const wdk::WindowEventChar& event)
+    { if (window.OnChar) window.OnChar(event); }
+    void OnMouseMove(const wdk::WindowEventMouseMove& event)
+    { if (window.OnMouseMove) window.OnMouseMove(event); }
+    void OnMousePress(const wdk::WindowEventMousePress& event)
+    { if (window.OnMousePress) window.OnMousePress(event); }
+    void OnMouseRelease(const wdk::WindowEventMouseRelease& event)
+    { if (window.OnMouseRelease) window.OnMouseRelease(event); }
+    void OnRawMouseMove(const wdk::WindowEventRawMouseMove& event)
+    { if (window.OnRawMouseMove) window.OnRawMouseMove(event); }
+};
+
+} // namespace
+
+namespace wdk
+{
+
+bool Window::ProcessEvent(const native_event_t& ev)
+{
+    // don't translate the events that have no callbacks bound,
+    // for example the key translation is a keymap lookup.
+    using Type = WindowEvent::Type;
+    bitflag<Type> wanted;
+    wanted.set(Type::Create,       static_cast<bool>(OnCreate));
+    wanted.set(Type::Show,         static_cast<bool>(OnShow));
+    wanted.set(Type::Paint,        static_cast<bool>(OnPaint));
+    wanted.set(Type::Resize,       static_cast<bool>(OnResize));
+    wanted.set(Type::GainFocus,    static_cast<bool>(OnGainFocus));
+    wanted.set(Type::LostFocus,    static_cast<bool>(OnLostFocus));
+    wanted.set(Type::WantClose,    static_cast<bool>(OnWantClose));
+    wanted.set(Type::KeyDown,      static_cast<bool>(OnKeyDown));
+    wanted.set(Type::KeyUp,        static_cast<bool>(OnKeyUp));
+    wanted.set(Type::Char,         static_cast<bool>(OnChar));
+    wanted.set(Type::MouseMove,    static_cast<bool>(OnMouseMove));
+    wanted.set(Type::MousePress,   static_cast<bool>(OnMousePress));
+    wanted.set(Type::MouseRelease, static_cast<bool>(OnMouseRelease));
+    wanted.set(Type::RawMouseMove, static_cast<bool>(OnRawMouseMove));
+
+    WindowEvent events[MaxDecodedEvents];
+    unsigned count = 0;
+    if (!DecodeEvent(ev, events, count, wanted))
+        return false;
+
+    // a callback can unbind the callback of the next event
+    // so the listener still checks them.
+    CallbackListener callbacks{*this};
+    for (unsigned i=0; i<count; ++i)
+        Dispatch(events[i], callbacks);
+    return true;
+}
+
+bool Window::DecodeEvent(const native_event_t& ev, WindowEvent* events, unsigned& count)
+{
+    bitflag<WindowEvent::Type> all;
+    all.set_from_value(~0u);
+    return DecodeEvent(ev, events, count, all);
+}
+
+} // wdk
@@ -30,21 +30,12 @@
 #include "wdk/callback.h"
 #include "wdk/utility.h"
 #include "wdk/types.h"
+#include "wdk/events.h"
+#include "wdk/bitflag.h"
 
 namespace wdk
 {
-    struct WindowEventCreate;
-    struct WindowEventPaint;
-    struct WindowEventResize;
-    struct WindowEventLostFocus;
-    struct WindowEventGainFocus;
-    struct WindowEventWantClose;
-    struct WindowEventKeyUp;
-    struct WindowEventKeyDown;
-    struct WindowEventChar;
-    struct WindowEventMouseMove;
-    struct WindowEventMousePress;
-    struct WindowEventMouseRelease;
+    class Display;
 
     class Window
     {
@@ -54,25 +45,36 @@ namespace wdk
             ASCII, UCS2, UTF8
         };
 
+        // window position and surface size.
+        struct Geometry {
+            int x = 0;
+            int y = 0;
+            uint_t width  = 0;
+            uint_t height = 0;
+        };
+
         // event callbacks
 
         // If this build time flag is enabled we can register
         // multiple listeners per each callback.
     #ifdef WDK_MULTIPLE_WINDOW_LISTENERS
         EventCallback<WindowEventCreate>       OnCreate;
+        EventCallback<WindowEventShow>         OnShow;
         EventCallback<WindowEventPaint>        OnPaint;
         EventCallback<WindowEventResize>       OnResize;
         EventCallback<WindowEventLostFocus>    OnLostFocus;
         EventCallback<WindowEventGainFocus>    OnGainFocus;
         EventCallback<WindowEventWantClose>    OnWantClose;
-        EventCallback<WindowEventKeydown>      OnKeyDown;
-        EventCallback<WindowEventKeyup>        OnKeyUp;
+        EventCallback<WindowEventKeyDown>      OnKeyDown;
+        EventCallback<WindowEventKeyUp>        OnKeyUp;
         EventCallback<WindowEventChar>         OnChar;
         EventCallback<WindowEventMouseMove>    OnMouseMove;
         EventCallback<WindowEventMousePress>   OnMousePress;
         EventCallback<WindowEventMouseRelease> OnMouseRelease;
+        EventCallback<WindowEventRawMouseMove> OnRawMouseMove;
     #else
         std::function<void (const WindowEventCreate&)>       OnCreate;
+        std::function<void (const WindowEventShow&)>         OnShow;
         std::function<void (const WindowEventPaint&)>        OnPaint;
         std::function<void (const WindowEventResize&)>       OnResize;
         std::function<void (const WindowEventLostFocus&)>    OnLostFocus;
@@ -84,9 +86,15 @@ namespace wdk
         std::function<void (const WindowEventMouseMove&)>    OnMouseMove;
         std::function<void (const WindowEventMousePress&)>   OnMousePress;
         std::function<void (const WindowEventMouseRelease&)> OnMouseRelease;
+        std::function<void (const WindowEventRawMouseMove&)> OnRawMouseMove;
     #endif
 
+        // Construct a window object for the default display.
         Window();
+        // Construct a window object for the given display. The display
+        // must outlive the window. Note that the windows on other than the
+        // default display are not added to the EventDispatcher.
+        explicit Window(Display& display);
        ~Window();
 
         // create the window with the given dimension and flags.
@@ -107,11 +115,17 @@ namespace wdk
         // destroy the window. window must have been created before.
         void Destroy();
 
-        // Invalidate the window contents.
-        // Erases the window contents with the background brush and eventually
-        // generates a paint event.
+        // Invalidate the whole window contents.
+        // Eventually generates a paint event.
         void Invalidate();
 
+        // Invalidate the given rectangle of the window contents.
+        // The damage is accumulated until the next paint event which then
+        // carries all the invalidated rectangles. At most one paint event
+        // is generated no matter how many times this is called before the
+        // paint event is processed.
+        void Invalidate(int x, int y, int width, int height);
+
         // move window to x,y position with respect to it's parent. (desktop)
         // precondition: not fullscreen
         // precondition: window has been created
@@ -136,6 +150,17 @@ namespace wdk
         // case false is returned to indicate failure. On success returns true.
         bool GrabMouse(bool on_off);
 
+        // Enable or disable relative mouse mode. In relative mode the
+        // mouse cursor is hidden and confined to the window (without
+        // warping it) and the raw unaccelerated mouse motion is delivered
+        // through OnRawMouseMove at the rate reported by the device.
+        // Returns false if the mode could not be changed, for example
+        // because the system doesn't support raw input or because another
+        // application has the mouse grabbed. On X11 only one window on a
+        // display can be in relative mode at a time and turning it on for
+        // another window returns false.
+        bool SetRelativeMouseMode(bool on);
+
         // set input focus to this window
         void SetFocus();
 
@@ -145,6 +170,21 @@ namespace wdk
         // set new character encoding for character events
         void SetEncoding(Encoding e);
 
+        // Enable or disable coalescing of resize events. When enabled
+        // a burst of window size changes (for example when the user is
+        // dragging the window border) produces only a single OnResize
+        // with the latest size instead of one for every intermediate size.
+        // Off by default.
+        void SetResizeCoalescing(bool on);
+
+        // Set how long Create waits for an initially visible window to
+        // actually become visible. The wait blocks on the display connection
+        // without using the CPU. With a timeout of 0 Create returns immediately
+        // and OnShow signals when the window is visible. If the timeout expires
+        // the window is still created and OnShow follows later.
+        // The default is NO_TIMEOUT, i.e. Create returns once the window is visible.
+        void SetCreateTimeout(ms_t timeout);
+
         // Set new window title to be show in the window's title bar (if it has one).
         // The title should be a UTF-8 encoded string.
         void SetTitle(const std::string& title);
@@ -153,10 +193,44 @@ namespace wdk
         // returns true if event was consumed otherwise false.
         bool ProcessEvent(const native_event_t& ev);
 
-        // get the current drawable window surface height
+        // Process the given event and call the listener's On* methods
+        // directly instead of going through the callbacks above.
+        // The listener can be any type with all the On* methods, for
+        // example a class derived from StaticWindowListener. With a
+        // WindowListener derived class mark the class final so that
+        // the virtual calls can be resolved at compile time.
+        // returns true if event was consumed otherwise false.
+        template<typename Listener>
+        bool ProcessEvent(const native_event_t& ev, Listener& listener)
+        {
+            WindowEvent events[MaxDecodedEvents];
+            unsigned count = 0;
+            if (!DecodeEvent(ev, events, count))
+                return false;
+
+            for (unsigned i=0; i<count; ++i)
+                Dispatch(events[i], listener);
+            return true;
+        }
+
+        // Maximum number of window events a single native event
+        // decodes into. (a key press produces a key down and a character)
+        static const unsigned MaxDecodedEvents = 2;
+
+        // Decode the given event into window events without invoking
+        // any callbacks. The events array must have room for
+        // MaxDecodedEvents events and count is set to the number of
+        // decoded events. Returns true if event was for this window
+        // otherwise false.
+        bool DecodeEvent(const native_event_t& ev, WindowEvent* events, unsigned& count);
+
+        // get the current drawable window surface height.
+        // On X11 the size is tracked from the window's events. After
+        // SetSize or SetFullscreen it's queried from the server once.
         uint_t GetSurfaceHeight() const;
 
-        // get the current drawable window surface width
+        // get the current drawable window surface width.
+        // See GetSurfaceHeight.
         uint_t GetSurfaceWidth() const;
 
         // get the window x coordinate relative to its parent (desktop)
@@ -167,6 +241,10 @@ namespace wdk
         // window's upper left corner.
         int GetPosY() const;
 
+        // get the window position (as GetPosX, GetPosY) and the drawable
+        // surface size (as GetSurfaceWidth, GetSurfaceHeight) in one call.
+        Geometry GetGeometry() const;
+
         // returns true if window currently exists. otherwise false.
         bool DoesExist() const;
 
@@ -186,6 +264,14 @@ namespace wdk
         // Get the dimensions for the window with biggest possible
         // dimensions.
         std::pair<uint_t, uint_t> GetMaxSize() const;
+    private:
+        // Decode only the given types of window events. The state that the
+        // other events update (such as the geometry and the damage) is still
+        // updated but they're not translated. The callback based ProcessEvent
+        // uses this to skip the events that have no callbacks bound.
+        bool DecodeEvent(const native_event_t& ev, WindowEvent* events, unsigned& count,
+            bitflag<WindowEvent::Type> wanted);
+
     private:
         struct impl;
 